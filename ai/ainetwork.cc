@@ -1,79 +1,179 @@
 #include "ainetwork.h"
+#include "gemv.h"
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <new>
 #include <numeric>
 
+namespace {
+    // Model files start with this, older ones straight with the layer count
+    constexpr char MAGIC[4] = {'A', 'C', 'N', 'N'};
+    constexpr uint32_t VERSION = 2;
+    
+    // predictBatch runs batches smaller than BATCH_MIN one input at a
+    // time, and bigger than BATCH_MAX in pieces
+    constexpr int BATCH_MIN = 8;
+    constexpr int BATCH_MAX = 64;
+    
+    // Activations for predict and predictBatch, kept per thread and grown
+    // to the largest size asked for, so inference allocates nothing once a
+    // thread has run its first pass of each kind
+    float* threadScratch(size_t floats) {
+        thread_local std::unique_ptr<float[], NetworkLayer::FreeDeleter> scratch;
+        thread_local size_t capacity = 0;
+        if (capacity < floats) {
+            scratch = NetworkLayer::alignedBlock(floats);
+            capacity = floats;
+        }
+        return scratch.get();
+    }
+}
+
+void NetworkLayer::allocate(int inputCount, int outputCount, int rowStride) {
+    inputs = inputCount;
+    outputs = outputCount;
+    stride = rowStride > 0 ? rowStride : roundToLine(inputCount);
+    block = alignedBlock(size());
+}
+
+std::unique_ptr<float[], NetworkLayer::FreeDeleter> NetworkLayer::alignedBlock(size_t floats) {
+    void* memory = nullptr;
+    if (posix_memalign(&memory, ALIGNMENT, floats * sizeof(float)) != 0) {
+        throw std::bad_alloc();
+    }
+    std::unique_ptr<float[], FreeDeleter> block(static_cast<float*>(memory));
+    std::fill(block.get(), block.get() + floats, 0.0f);
+    return block;
+}
+
+size_t NetworkLayer::size() const {
+    return static_cast<size_t>(outputs) * stride + roundToLine(outputs);
+}
+
 AINetwork::AINetwork(const std::vector<int>& layers) 
     : layerSizes(layers), rng(std::random_device{}()) {
     
     // Initialize weights and biases
-    weights.resize(layers.size() - 1);
-    biases.resize(layers.size() - 1);
+    this->layers.resize(layers.size() - 1);
     
     std::normal_distribution<float> weightDist(0.0f, 0.1f);
     
-    for (size_t i = 0; i < weights.size(); ++i) {
-        int inputSize = layers[i];
-        int outputSize = layers[i + 1];
+    for (size_t i = 0; i < this->layers.size(); ++i) {
+        NetworkLayer& layer = this->layers[i];
+        layer.allocate(layers[i], layers[i + 1]);
         
-        weights[i].resize(outputSize);
-        biases[i].resize(outputSize);
-        
-        for (int j = 0; j < outputSize; ++j) {
-            weights[i][j].resize(inputSize);
-            biases[i][j] = weightDist(rng);
+        for (int j = 0; j < layer.outputs; ++j) {
+            layer.biases()[j] = weightDist(rng);
             
-            for (int k = 0; k < inputSize; ++k) {
-                weights[i][j][k] = weightDist(rng);
+            float* row = layer.row(j);
+            for (int k = 0; k < layer.inputs; ++k) {
+                row[k] = weightDist(rng);
             }
         }
     }
 }
 
-float AINetwork::relu(float x) {
-    return std::max(0.0f, x);
-}
-
 float AINetwork::reluDerivative(float x) {
     return x > 0 ? 1.0f : 0.0f;
 }
 
-std::vector<float> AINetwork::matrixMultiply(const std::vector<float>& input,
-                                           const std::vector<std::vector<float>>& weights,
-                                           const std::vector<float>& bias) {
-    std::vector<float> output(weights.size());
-    
-    for (size_t i = 0; i < weights.size(); ++i) {
-        output[i] = bias[i];
-        for (size_t j = 0; j < input.size(); ++j) {
-            output[i] += input[j] * weights[i][j];
-        }
-    }
-    
+std::vector<float> AINetwork::matrixMultiply(const std::vector<float>& input, const NetworkLayer& layer, bool relu) {
+    std::vector<float> output(layer.outputs);
+    Gemv::forward(layer, input.data(), output.data(), relu);
     return output;
 }
 
+size_t AINetwork::widestLayer() const {
+    return *std::max_element(layerSizes.begin(), layerSizes.end());
+}
+
 std::vector<float> AINetwork::predict(const std::vector<float>& input) {
-    std::vector<float> currentLayer = input;
+    std::vector<float> output(getOutputSize());
+    predict(input.data(), output.data());
+    return output;
+}
+
+void AINetwork::predict(const float* input, float* output) {
+    predict(input, output, threadScratch(getScratchSize()));
+}
+
+void AINetwork::predict(const float* input, float* output, float* scratch) {
+    float* current = scratch;
+    float* next = scratch + widestLayer();
+    
+    // Forward pass through all layers, ReLU for hidden layers and linear
+    // for the output layer's Q-values
+    const float* layerInput = input;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        bool last = i == layers.size() - 1;
+        float* layerOutput = last ? output : next;
+        Gemv::forward(layers[i], layerInput, layerOutput, !last);
+        
+        std::swap(current, next);
+        layerInput = current;
+    }
+}
+
+std::vector<float> AINetwork::predictBatch(const std::vector<float>& inputs, int batch) {
+    std::vector<float> outputs(static_cast<size_t>(batch) * getOutputSize());
+    predictBatch(inputs.data(), batch, outputs.data());
+    return outputs;
+}
+
+void AINetwork::predictBatch(const float* inputs, int batch, float* outputs) {
+    int inputSize = getInputSize();
+    int outputSize = getOutputSize();
+    
+    // Columns are padded to a cache line, too much waste for a few inputs
+    if (batch < BATCH_MIN) {
+        for (int b = 0; b < batch; ++b) {
+            predict(inputs + static_cast<size_t>(b) * inputSize, outputs + static_cast<size_t>(b) * outputSize);
+        }
+        return;
+    }
+    
+    // Layers run on activations one row per neuron and one column per
+    // input, padded to whole cache lines. Big batches go BATCH_MAX inputs
+    // at a time so the activations stay in cache.
+    size_t widest = widestLayer();
+    float* current = threadScratch(2 * widest * BATCH_MAX);
+    float* next = current + widest * BATCH_MAX;
     
-    // Forward pass through all layers
-    for (size_t i = 0; i < weights.size(); ++i) {
-        std::vector<float> nextLayer = matrixMultiply(currentLayer, weights[i], biases[i]);
+    for (int start = 0; start < batch; start += BATCH_MAX) {
+        int count = std::min(BATCH_MAX, batch - start);
+        int columns = NetworkLayer::roundToLine(count);
         
-        // Apply activation function (ReLU for hidden layers, linear for output)
-        if (i < weights.size() - 1) {  // Hidden layers
-            for (float& val : nextLayer) {
-                val = relu(val);
+        // Eight features at a time, so the reads of each input stay in
+        // cache lines already loaded
+        for (int first = 0; first < inputSize; first += 8) {
+            int last = std::min(inputSize, first + 8);
+            for (int b = 0; b < count; ++b) {
+                const float* input = inputs + static_cast<size_t>(start + b) * inputSize;
+                for (int j = first; j < last; ++j) {
+                    current[static_cast<size_t>(j) * columns + b] = input[j];
+                }
             }
         }
-        // Output layer uses linear activation for Q-values
+        for (int j = 0; j < inputSize && count < columns; ++j) {
+            std::fill(&current[static_cast<size_t>(j) * columns + count], &current[static_cast<size_t>(j + 1) * columns], 0.0f);
+        }
+        
+        for (size_t i = 0; i < layers.size(); ++i) {
+            Gemv::forwardBatch(layers[i], current, next, columns, i < layers.size() - 1);
+            std::swap(current, next);
+        }
         
-        currentLayer = std::move(nextLayer);
+        for (int b = 0; b < count; ++b) {
+            float* output = outputs + static_cast<size_t>(start + b) * outputSize;
+            for (int i = 0; i < outputSize; ++i) {
+                output[i] = current[static_cast<size_t>(i) * columns + b];
+            }
+        }
     }
-    
-    return currentLayer;
 }
 
 void AINetwork::train(const std::vector<float>& input, const std::vector<float>& target, float learningRate) {
@@ -83,50 +183,46 @@ void AINetwork::train(const std::vector<float>& input, const std::vector<float>&
     
     // Forward pass and store intermediate outputs
     std::vector<float> currentLayer = input;
-    for (size_t i = 0; i < weights.size(); ++i) {
-        std::vector<float> nextLayer = matrixMultiply(currentLayer, weights[i], biases[i]);
-        
-        if (i < weights.size() - 1) {  // Hidden layers
-            for (float& val : nextLayer) {
-                val = relu(val);
-            }
-        }
+    for (size_t i = 0; i < layers.size(); ++i) {
+        std::vector<float> nextLayer = matrixMultiply(currentLayer, layers[i], i < layers.size() - 1);
         
         layerOutputs.push_back(nextLayer);
         currentLayer = nextLayer;
     }
     
     // Backward pass
-    std::vector<std::vector<float>> deltas(weights.size());
+    std::vector<std::vector<float>> deltas(layers.size());
     
     // Output layer error
-    deltas[weights.size() - 1].resize(target.size());
+    deltas[layers.size() - 1].resize(target.size());
     for (size_t i = 0; i < target.size(); ++i) {
-        deltas[weights.size() - 1][i] = target[i] - layerOutputs.back()[i];
+        deltas[layers.size() - 1][i] = target[i] - layerOutputs.back()[i];
     }
     
     // Hidden layers error (backpropagate)
-    for (int layer = weights.size() - 2; layer >= 0; --layer) {
+    for (int layer = layers.size() - 2; layer >= 0; --layer) {
         deltas[layer].resize(layerSizes[layer + 1]);
         
         for (int i = 0; i < layerSizes[layer + 1]; ++i) {
             float error = 0.0f;
             for (int j = 0; j < layerSizes[layer + 2]; ++j) {
-                error += deltas[layer + 1][j] * weights[layer + 1][j][i];
+                error += deltas[layer + 1][j] * layers[layer + 1].row(j)[i];
             }
             deltas[layer][i] = error * reluDerivative(layerOutputs[layer + 1][i]);
         }
     }
     
     // Update weights and biases
-    for (size_t layer = 0; layer < weights.size(); ++layer) {
-        for (size_t i = 0; i < weights[layer].size(); ++i) {
+    for (size_t layer = 0; layer < layers.size(); ++layer) {
+        float* bias = layers[layer].biases();
+        for (int i = 0; i < layers[layer].outputs; ++i) {
             // Update bias
-            biases[layer][i] += learningRate * deltas[layer][i];
+            bias[i] += learningRate * deltas[layer][i];
             
             // Update weights
-            for (size_t j = 0; j < weights[layer][i].size(); ++j) {
-                weights[layer][i][j] += learningRate * deltas[layer][i] * layerOutputs[layer][j];
+            float* row = layers[layer].row(i);
+            for (int j = 0; j < layers[layer].inputs; ++j) {
+                row[j] += learningRate * deltas[layer][i] * layerOutputs[layer][j];
             }
         }
     }
@@ -147,25 +243,27 @@ void AINetwork::saveToFile(const std::string& filename) {
         return;
     }
     
-    // Save layer sizes
-    size_t numLayers = layerSizes.size();
+    // Header: magic, version, layer sizes and each layer's row stride
+    file.write(MAGIC, sizeof(MAGIC));
+    file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    
+    uint64_t numLayers = layerSizes.size();
     file.write(reinterpret_cast<const char*>(&numLayers), sizeof(numLayers));
     file.write(reinterpret_cast<const char*>(layerSizes.data()), numLayers * sizeof(int));
+    for (const NetworkLayer& layer : layers) {
+        file.write(reinterpret_cast<const char*>(&layer.stride), sizeof(layer.stride));
+    }
     
-    // Save weights and biases
-    for (size_t layer = 0; layer < weights.size(); ++layer) {
-        for (size_t i = 0; i < weights[layer].size(); ++i) {
-            size_t weightSize = weights[layer][i].size();
-            file.write(reinterpret_cast<const char*>(&weightSize), sizeof(weightSize));
-            file.write(reinterpret_cast<const char*>(weights[layer][i].data()), weightSize * sizeof(float));
-        }
-        
-        size_t biasSize = biases[layer].size();
-        file.write(reinterpret_cast<const char*>(&biasSize), sizeof(biasSize));
-        file.write(reinterpret_cast<const char*>(biases[layer].data()), biasSize * sizeof(float));
+    // Then each layer's block as it is in memory
+    for (const NetworkLayer& layer : layers) {
+        file.write(reinterpret_cast<const char*>(layer.block.get()), layer.size() * sizeof(float));
     }
     
     file.close();
+    if (!file) {
+        std::cerr << "Error: Could not save network to " << filename << std::endl;
+        return;
+    }
     std::cout << "Network saved to " << filename << std::endl;
 }
 
@@ -176,36 +274,82 @@ void AINetwork::loadFromFile(const std::string& filename) {
         return;
     }
     
-    // Load layer sizes
-    size_t numLayers;
-    file.read(reinterpret_cast<char*>(&numLayers), sizeof(numLayers));
+    char magic[sizeof(MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    bool loaded;
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        file.clear();
+        file.seekg(0);
+        loaded = loadLegacy(file);
+    }
+    else {
+        uint32_t version = 0;
+        uint64_t numLayers = 0;
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&numLayers), sizeof(numLayers));
+        loaded = file && version == VERSION && numLayers >= 2 && numLayers <= 64;
+        
+        std::vector<int> sizes(loaded ? numLayers : 0);
+        std::vector<int> strides(loaded ? numLayers - 1 : 0);
+        file.read(reinterpret_cast<char*>(sizes.data()), sizes.size() * sizeof(int));
+        file.read(reinterpret_cast<char*>(strides.data()), strides.size() * sizeof(int));
+        
+        // One read per layer, straight into its block
+        std::vector<NetworkLayer> fileLayers(strides.size());
+        for (size_t i = 0; loaded && i < fileLayers.size(); ++i) {
+            if (sizes[i] <= 0 || sizes[i + 1] <= 0 || strides[i] < sizes[i] ||
+                strides[i] % NetworkLayer::FLOATS_PER_LINE != 0) {
+                loaded = false;
+                break;
+            }
+            fileLayers[i].allocate(sizes[i], sizes[i + 1], strides[i]);
+            file.read(reinterpret_cast<char*>(fileLayers[i].block.get()), fileLayers[i].size() * sizeof(float));
+            loaded = static_cast<bool>(file);
+        }
+        
+        if (loaded) {
+            layerSizes = std::move(sizes);
+            layers = std::move(fileLayers);
+        }
+    }
     
-    layerSizes.resize(numLayers);
-    file.read(reinterpret_cast<char*>(layerSizes.data()), numLayers * sizeof(int));
+    if (!loaded) {
+        std::cerr << "Error: " << filename << " is not a network model" << std::endl;
+        return;
+    }
+    std::cout << "Network loaded from " << filename << std::endl;
+}
+
+bool AINetwork::loadLegacy(std::istream& file) {
+    // Layer sizes, then per layer each weight row and the biases, every
+    // one with its length in front
+    size_t numLayers = 0;
+    file.read(reinterpret_cast<char*>(&numLayers), sizeof(numLayers));
+    if (!file || numLayers < 2 || numLayers > 64) return false;
     
-    // Reinitialize network structure
-    weights.resize(layerSizes.size() - 1);
-    biases.resize(layerSizes.size() - 1);
+    std::vector<int> sizes(numLayers);
+    file.read(reinterpret_cast<char*>(sizes.data()), numLayers * sizeof(int));
     
-    // Load weights and biases
-    for (size_t layer = 0; layer < weights.size(); ++layer) {
-        weights[layer].resize(layerSizes[layer + 1]);
+    std::vector<NetworkLayer> fileLayers(numLayers - 1);
+    for (size_t layer = 0; layer < fileLayers.size(); ++layer) {
+        if (!file || sizes[layer] <= 0 || sizes[layer + 1] <= 0) return false;
+        fileLayers[layer].allocate(sizes[layer], sizes[layer + 1]);
         
-        for (size_t i = 0; i < weights[layer].size(); ++i) {
-            size_t weightSize;
+        for (int i = 0; i < sizes[layer + 1]; ++i) {
+            size_t weightSize = 0;
             file.read(reinterpret_cast<char*>(&weightSize), sizeof(weightSize));
-            
-            weights[layer][i].resize(weightSize);
-            file.read(reinterpret_cast<char*>(weights[layer][i].data()), weightSize * sizeof(float));
+            if (weightSize != static_cast<size_t>(sizes[layer])) return false;
+            file.read(reinterpret_cast<char*>(fileLayers[layer].row(i)), weightSize * sizeof(float));
         }
         
-        size_t biasSize;
+        size_t biasSize = 0;
         file.read(reinterpret_cast<char*>(&biasSize), sizeof(biasSize));
-        
-        biases[layer].resize(biasSize);
-        file.read(reinterpret_cast<char*>(biases[layer].data()), biasSize * sizeof(float));
+        if (biasSize != static_cast<size_t>(sizes[layer + 1])) return false;
+        file.read(reinterpret_cast<char*>(fileLayers[layer].biases()), biasSize * sizeof(float));
     }
+    if (!file) return false;
     
-    file.close();
-    std::cout << "Network loaded from " << filename << std::endl;
+    layerSizes = std::move(sizes);
+    layers = std::move(fileLayers);
+    return true;
 }
@@ -1,49 +1,102 @@
 #ifndef __AINETWORK_H__
 #define __AINETWORK_H__
 
+#include <cstddef>
+#include <cstdlib>
+#include <iosfwd>
 #include <vector>
 #include <memory>
 #include <random>
+#include <string>
+
+// One layer's parameters in a single 64 byte aligned block: the weights one
+// row per output neuron, each row padded with zeros to a whole number of
+// cache lines, then the biases. Saved and loaded as the block it is.
+struct NetworkLayer {
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr int FLOATS_PER_LINE = ALIGNMENT / sizeof(float);
+
+    struct FreeDeleter {
+        void operator()(float* block) const { std::free(block); }
+    };
+
+    int inputs;
+    int outputs;
+    int stride;  // floats from one row to the next
+    std::unique_ptr<float[], FreeDeleter> block;
+
+    // Zeroed storage for an inputs -> outputs layer, stride 0 for the
+    // smallest whole number of cache lines
+    void allocate(int inputCount, int outputCount, int rowStride = 0);
+    // Zeroed 64 byte aligned floats, also used for batch activations
+    static std::unique_ptr<float[], FreeDeleter> alignedBlock(size_t floats);
+
+    float* row(int neuron) { return block.get() + static_cast<size_t>(neuron) * stride; }
+    const float* row(int neuron) const { return block.get() + static_cast<size_t>(neuron) * stride; }
+    float* biases() { return row(outputs); }
+    const float* biases() const { return row(outputs); }
+    // Floats in the block, weights and biases with their padding
+    size_t size() const;
+
+    static int roundToLine(int floats) { return (floats + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE; }
+};
 
 // Simple neural network implementation for the AI
 class AINetwork {
 private:
-    std::vector<std::vector<std::vector<float>>> weights;  // weights[layer][neuron][input]
-    std::vector<std::vector<float>> biases;                // biases[layer][neuron]
+    std::vector<NetworkLayer> layers;
     std::vector<int> layerSizes;
     std::mt19937 rng;
-    
+
     // Activation functions
-    float relu(float x);
     float reluDerivative(float x);
-    
+
     // Helper methods
-    std::vector<float> matrixMultiply(const std::vector<float>& input, 
-                                     const std::vector<std::vector<float>>& weights, 
-                                     const std::vector<float>& bias);
-    
+    // Layer output, with ReLU applied for a hidden layer
+    std::vector<float> matrixMultiply(const std::vector<float>& input, const NetworkLayer& layer, bool relu);
+
+    // Floats in the largest layer, the size of an activation buffer
+    size_t widestLayer() const;
+
+    // Model files from before the flat layout, one read per weight row
+    bool loadLegacy(std::istream& file);
+
 public:
     AINetwork(const std::vector<int>& layers);
     ~AINetwork() = default;
-    
+
     // Forward pass
     std::vector<float> predict(const std::vector<float>& input);
-    
+    // Forward pass from getInputSize() floats into getOutputSize() floats.
+    // Activations live in per-thread scratch sized from the layer sizes,
+    // so after a thread's first call this allocates nothing.
+    void predict(const float* input, float* output);
+    // The same with caller-owned scratch of getScratchSize() floats, for
+    // threads that come and go
+    void predict(const float* input, float* output, float* scratch);
+    // Forward pass for batch inputs stored one after another, giving their
+    // outputs the same way; runs each layer as one matrix-matrix product
+    std::vector<float> predictBatch(const std::vector<float>& inputs, int batch);
+    // The same into caller-owned outputs, allocation free like predict
+    void predictBatch(const float* inputs, int batch, float* outputs);
+
     // Training
     void train(const std::vector<float>& input, const std::vector<float>& target, float learningRate);
-    
+
     // Batch training
-    void trainBatch(const std::vector<std::vector<float>>& inputs, 
-                   const std::vector<std::vector<float>>& targets, 
+    void trainBatch(const std::vector<std::vector<float>>& inputs,
+                   const std::vector<std::vector<float>>& targets,
                    float learningRate);
-    
+
     // Save/load network
     void saveToFile(const std::string& filename);
     void loadFromFile(const std::string& filename);
-    
+
     // Network info
     int getInputSize() const { return layerSizes.front(); }
     int getOutputSize() const { return layerSizes.back(); }
+    size_t getScratchSize() const { return 2 * widestLayer(); }
+    const std::vector<NetworkLayer>& getLayers() const { return layers; }
 };
 
 #endif
@@ -1,6 +1,11 @@
 #include "aiplayer.h"
 #include "ainetwork.h"
+#include "openingbook.h"
+#include "quantizednetwork.h"
+#include "tablebase.h"
 #include "../game/board.h"
+#include "../game/gamestate.h"
+#include "../game/zobrist.h"
 #include "../game/tile.h"
 #include "../game/gamepiece.h"
 #include "../game/tileeffect.h"
@@ -11,7 +16,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <limits>
-#include <set>
+#include <numeric>
 
 AIPlayer::AIPlayer(int index, char startingPiece, double learningRate)
     : Player(index, startingPiece), 
@@ -26,22 +31,22 @@ AIPlayer::AIPlayer(int index, char startingPiece, double learningRate)
       rng(std::random_device{}())
 {
     // Initialize neural network
-    // State size: board positions (11x9) + piece information + game state
-    int stateSize = 11 * 9 * 4;  // 4 features per tile: piece, owner, effect, water/wall
-    int actionSize = 8 * 4;      // 8 pieces * 4 directions
-    
-    std::vector<int> networkLayers = {stateSize, 256, 128, 64, actionSize};
-    network = std::make_unique<AINetwork>(networkLayers);
+    network = std::make_unique<AINetwork>(getNetworkLayers());
     
     memory.reserve(memorySize);
 }
 
 AIPlayer::~AIPlayer() = default;
 
-std::vector<float> AIPlayer::boardToStateVector(Board* board) {
-    std::vector<float> state;
-    state.reserve(11 * 9 * 4);
-    
+std::vector<int> AIPlayer::getNetworkLayers() {
+    // State size: board positions (11x9) + piece information + game state
+    int stateSize = 11 * 9 * 4;  // 4 features per tile: piece, owner, effect, water/wall
+    int actionSize = 8 * 4;      // 8 pieces * 4 directions
+
+    return {stateSize, 256, 128, 64, actionSize};
+}
+
+void AIPlayer::boardToStateVector(Board* board, float* state) {
     for (int row = 0; row < board->getLength(); ++row) {
         for (int col = 0; col < board->getWidth(); ++col) {
             Tile* tile = board->getTile(row, col);
@@ -49,100 +54,98 @@ std::vector<float> AIPlayer::boardToStateVector(Board* board) {
             // Feature 1: Piece type (normalized)
             GamePiece* piece = tile->getPiece();
             if (piece) {
-                state.push_back((piece->getPiece() - '1') / 8.0f);  // Normalize piece ID
+                *state++ = (piece->getPiece() - '1') / 8.0f;  // Normalize piece ID
             } else {
-                state.push_back(0.0f);
+                *state++ = 0.0f;
             }
             
             // Feature 2: Piece owner (normalized)
             if (piece) {
-                state.push_back(piece->getOwner()->getIndex() / 2.0f);  // 0 or 0.5
+                *state++ = piece->getOwner()->getIndex() / 2.0f;  // 0 or 0.5
             } else {
-                state.push_back(-1.0f);  // No piece
+                *state++ = -1.0f;  // No piece
             }
             
             // Feature 3: Tile effects
             TileEffect* effect = tile->getTileEffect();
             if (effect) {
                 if (effect->isGoal()) {
-                    state.push_back(1.0f);
+                    *state++ = 1.0f;
                 } else if (effect->isTrap()) {
-                    state.push_back(0.5f);
+                    *state++ = 0.5f;
                 } else {
-                    state.push_back(0.25f);
+                    *state++ = 0.25f;
                 }
             } else {
-                state.push_back(0.0f);
+                *state++ = 0.0f;
             }
             
             // Feature 4: Terrain (wall/water)
             if (tile->getIsWall()) {
-                state.push_back(1.0f);
+                *state++ = 1.0f;
             } else if (tile->getIsWater()) {
-                state.push_back(0.5f);
+                *state++ = 0.5f;
             } else {
-                state.push_back(0.0f);
+                *state++ = 0.0f;
             }
         }
     }
-    
-    return state;
 }
 
-std::vector<std::pair<char, char>> AIPlayer::getAllValidMoves(Board* board) {
-    std::vector<std::pair<char, char>> validMoves;
-    std::vector<char> directions = {'N', 'S', 'E', 'W'};
-    
-    // We need to get the actual pieces from the board/game state
-    // since the AI player's pieces map is not properly linked.
-    // We'll check which pieces are alive by examining the board state.
-    
-    // Get all pieces for this player by checking the board tiles
-    std::set<char> alivePieces;
-    for (int row = 0; row < board->getLength(); row++) {
-        for (int col = 0; col < board->getWidth(); col++) {
-            Tile* tile = board->getTile(row, col);
-            if (tile && tile->getPiece() != nullptr) {
-                GamePiece* piece = tile->getPiece();
-                if (piece->getOwner()->getIndex() == getIndex()) {
-                    // This piece belongs to this AI player and is on the board (alive)
-                    char pieceId = piece->getPiece();
-                    alivePieces.insert(pieceId);
+namespace {
+    // stateToVector's features, read from the other end of the board with
+    // the colours swapped when turned
+    void writeFeatures(const GameState& state, bool turned, float* features) {
+        for (int row = 0; row < Constants::BOARD_SIZE_2_PLAYER; ++row) {
+            for (int col = 0; col < Constants::BOARD_WIDTH_2_PLAYER; ++col) {
+                bool isWall = row < 1 || row > Constants::PLAYABLE_LENGTH || col < 1 || col > Constants::PLAYABLE_WIDTH;
+                if (isWall) {
+                    *features++ = 0.0f;
+                    *features++ = -1.0f;
+                    *features++ = 0.0f;
+                    *features++ = 1.0f;
+                    continue;
                 }
+
+                int square = GameState::toSquare(row, col);
+                if (turned) {
+                    square = Constants::NUM_SQUARES - 1 - square;
+                }
+                uint64_t bit = GameState::bit(square);
+
+                // Features 1 and 2: piece type and owner
+                int owner;
+                int piece = state.pieceAt(square, owner);
+                if (piece >= 0) {
+                    *features++ = piece / 8.0f;
+                    *features++ = (owner ^ turned) / 2.0f;
+                } else {
+                    *features++ = 0.0f;
+                    *features++ = -1.0f;
+                }
+
+                // Feature 3: tile effects
+                if ((state.denMask[0] | state.denMask[1]) & bit) {
+                    *features++ = 1.0f;
+                } else if (state.trapMask & bit) {
+                    *features++ = 0.5f;
+                } else {
+                    *features++ = 0.0f;
+                }
+
+                // Feature 4: terrain
+                *features++ = (state.waterMask & bit) ? 0.5f : 0.0f;
             }
         }
     }
-    
-    // Generate moves only for pieces that are actually alive and on the board
-    for (char pieceId : alivePieces) {
-        for (char dir : directions) {
-            validMoves.push_back({pieceId, dir});
-        }
-    }
-    
-    if (!validMoves.empty()) {
-        if (!trainingMode) {
-            std::cerr << "DEBUG: AI Player " << getIndex() << " found " << alivePieces.size()
-                      << " alive pieces, generated " << validMoves.size() << " potential moves" << std::endl;
-        }
-    } else {
-        if (!trainingMode) {
-            std::cerr << "DEBUG: AI Player " << getIndex() << " found no alive pieces on board!" << std::endl;
-        }
-        
-        // Emergency fallback: generate all possible moves and let the retry mechanism handle invalids
-        for (char pieceId = '1'; pieceId <= '8'; pieceId++) {
-            for (char dir : directions) {
-                validMoves.push_back({pieceId, dir});
-            }
-        }
-        // Only print fallback message if not in training mode
-        if (!trainingMode) {
-            std::cerr << "  Using fallback: generated " << validMoves.size() << " fallback moves" << std::endl;
-        }
-    }
-    
-    return validMoves;
+}
+
+void AIPlayer::stateToVector(const GameState& state, float* features) {
+    writeFeatures(state, false, features);
+}
+
+void AIPlayer::moverToVector(const GameState& state, float* features) {
+    writeFeatures(state, state.sideToMove == 1, features);
 }
 
 int AIPlayer::actionToIndex(char piece, char direction) {
@@ -175,45 +178,58 @@ std::pair<char, char> AIPlayer::indexToAction(int index) {
     return {piece, direction};
 }
 
-std::pair<char, char> AIPlayer::chooseMove(Board* board) {
-    std::vector<std::pair<char, char>> validMoves = getAllValidMoves(board);
-    
-    if (validMoves.empty()) {
-        // No valid moves - this shouldn't happen in a proper game
-        return {'1', 'N'};
+Move AIPlayer::chooseMove(Board* board, const MoveList& legalMoves) {
+    if (book || tablebase) {
+        GameState state = board->saveState();
+        if (state.sideToMove != getIndex()) {
+            state.sideToMove = getIndex();
+            state.hash = Zobrist::hash(state);
+        }
+
+        Move known;
+        BookEntry stats;
+        TBResult result;
+        if ((book && book->probe(state, known, stats)) || (tablebase && tablebase->bestMove(state, known, result))) {
+            for (const Move& move : legalMoves) {
+                if (move == known) {
+                    return move;
+                }
+            }
+        }
     }
-    
+
     // Epsilon-greedy action selection
     std::uniform_real_distribution<double> dist(0.0, 1.0);
     if (dist(rng) < epsilon) {
         // Random action (exploration)
-        std::uniform_int_distribution<int> moveChoice(0, validMoves.size() - 1);
-        return validMoves[moveChoice(rng)];
-    } else {
-        // Use neural network (exploitation)
-        std::vector<float> state = boardToStateVector(board);
-        std::vector<float> qValues = network->predict(state);
-        
-        // Find the best valid action
-        int bestAction = -1;
-        float bestQValue = -std::numeric_limits<float>::infinity();
-        
-        for (const auto& move : validMoves) {
-            int actionIndex = actionToIndex(move.first, move.second);
-            if (actionIndex >= 0 && actionIndex < qValues.size() && qValues[actionIndex] > bestQValue) {
-                bestQValue = qValues[actionIndex];
-                bestAction = actionIndex;
-            }
-        }
-        
-        if (bestAction >= 0) {
-            return indexToAction(bestAction);
-        } else {
-            // Fallback to random
-            std::uniform_int_distribution<int> moveChoice(0, validMoves.size() - 1);
-            return validMoves[moveChoice(rng)];
+        std::uniform_int_distribution<int> moveChoice(0, legalMoves.size() - 1);
+        return legalMoves[moveChoice(rng)];
+    }
+
+    // Use neural network (exploitation), best Q-value among the legal moves.
+    // The buffers keep their size between moves, so this allocates nothing.
+    features.resize(network->getInputSize());
+    qValues.resize(network->getOutputSize());
+    boardToStateVector(board, features.data());
+    if (quantized) {
+        quantized->predict(features.data(), qValues.data());
+    }
+    else {
+        network->predict(features.data(), qValues.data());
+    }
+
+    int best = 0;
+    float bestQValue = -std::numeric_limits<float>::infinity();
+
+    for (int i = 0; i < legalMoves.size(); i++) {
+        float qValue = qValues[legalMoves[i].getActionIndex()];
+        if (qValue > bestQValue) {
+            bestQValue = qValue;
+            best = i;
         }
     }
+
+    return legalMoves[best];
 }
 
 float AIPlayer::calculateReward(Constants::MOVE_RESULT result, bool gameWon, bool gameLost, Board* board, char pieceId) {
@@ -342,18 +358,40 @@ void AIPlayer::replay(int batchSize) {
     std::iota(indices.begin(), indices.end(), 0);
     std::shuffle(indices.begin(), indices.end(), rng);
     
-    std::vector<std::vector<float>> states, targets;
+    int samples = std::min(batchSize, (int)memory.size());
+    int stateSize = network->getInputSize();
+    int actionCount = network->getOutputSize();
     
-    for (int i = 0; i < std::min(batchSize, (int)memory.size()); ++i) {
+    // Every sampled state, then the next state of each that isn't the end
+    // of a game, through the network in one batch
+    std::vector<float> batch;
+    batch.reserve(static_cast<size_t>(2 * samples) * stateSize);
+    for (int i = 0; i < samples; ++i) {
+        const Experience& exp = memory[indices[i]];
+        batch.insert(batch.end(), exp.state.begin(), exp.state.end());
+    }
+    int rows = samples;
+    for (int i = 0; i < samples; ++i) {
+        const Experience& exp = memory[indices[i]];
+        if (!exp.gameOver) {
+            batch.insert(batch.end(), exp.nextState.begin(), exp.nextState.end());
+            ++rows;
+        }
+    }
+    std::vector<float> qValues = network->predictBatch(batch, rows);
+    
+    std::vector<std::vector<float>> states, targets;
+    int nextRow = samples;
+    for (int i = 0; i < samples; ++i) {
         const Experience& exp = memory[indices[i]];
         
-        std::vector<float> target = network->predict(exp.state);
+        std::vector<float> target(qValues.begin() + i * actionCount, qValues.begin() + (i + 1) * actionCount);
         
         if (exp.gameOver) {
             target[exp.action] = exp.reward;
         } else {
-            std::vector<float> nextQValues = network->predict(exp.nextState);
-            float maxNextQ = *std::max_element(nextQValues.begin(), nextQValues.end());
+            auto nextQValues = qValues.begin() + nextRow++ * actionCount;
+            float maxNextQ = *std::max_element(nextQValues, nextQValues + actionCount);
             target[exp.action] = exp.reward + 0.95f * maxNextQ;  // Discount factor
         }
         
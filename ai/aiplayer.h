@@ -4,17 +4,25 @@
 #include "../game/player.h"
 #include "../game/board.h"
 #include "../game/constants.h"
+#include "../game/move.h"
 #include <vector>
 #include <random>
 #include <memory>
+#include <utility>
 
 // Forward declarations
-class GameState;
+struct GameState;
 class AINetwork;
+class OpeningBook;
+class Tablebase;
+class QuantizedNetwork;
 
 class AIPlayer : public Player {
 private:
     std::unique_ptr<AINetwork> network;
+    std::shared_ptr<const OpeningBook> book;
+    std::shared_ptr<const Tablebase> tablebase;
+    std::shared_ptr<const QuantizedNetwork> quantized;
     std::mt19937 rng;
     
     // AI parameters
@@ -36,6 +44,10 @@ private:
     std::vector<Experience> memory;
     int memoryIndex;
     
+    // Network input and output for chooseMove, reused between moves
+    std::vector<float> features;
+    std::vector<float> qValues;
+    
     // Reward tracking for visualization
     double totalReward;
     std::vector<double> gameRewards;
@@ -44,7 +56,6 @@ private:
     bool trainingMode;
     
     // Helper methods (private)
-    std::vector<std::pair<char, char>> getAllValidMoves(Board* board);
     std::pair<char, char> indexToAction(int index);
     
     void remember(const std::vector<float>& state, int action, float reward, 
@@ -55,15 +66,43 @@ public:
     AIPlayer(int index, char startingPiece, double learningRate = 0.001);
     ~AIPlayer();
     
+    // Network shape: 4 features per tile of the 11x9 board in, one
+    // Q-value per piece/direction out
+    static std::vector<int> getNetworkLayers();
+
     // Public methods so Controller can access them
-    std::vector<float> boardToStateVector(Board* board);
+    // Network input for board, getNetworkLayers().front() floats into state
+    void boardToStateVector(Board* board, float* state);
+    // Same features as boardToStateVector, read from a GameState
+    static void stateToVector(const GameState& state, float* features);
+    // Features for a network trained as player 0, whoever is to move: with
+    // player 1 to move the board is turned 180 degrees and the colours
+    // swapped, as Tablebase::locate does
+    static void moverToVector(const GameState& state, float* features);
+    // That network's output for move by side. Turning the board swaps N
+    // with S and E with W, the low bit of the direction.
+    static int moverActionIndex(int side, const Move& move) {
+        return move.getActionIndex() ^ (side == 1 ? 1 : 0);
+    }
     int actionToIndex(char piece, char direction);
     float calculateReward(Constants::MOVE_RESULT result, bool gameWon, bool gameLost, Board* board = nullptr, char pieceId = '0');
     float calculateGoalProgressReward(Board* board, char pieceId);
     float calculatePositionalReward(Board* board);
     
-    // Override the move method to use AI decision making
-    std::pair<char, char> chooseMove(Board* board);
+    // Picks one of legalMoves (from Board::generateLegalMoves), costs at most
+    // one network forward pass. Book openings and endgames covered by the
+    // tablebase are played without the network.
+    Move chooseMove(Board* board, const MoveList& legalMoves) override;
+
+    // Opening book from bookgen, shared with other players
+    void setOpeningBook(std::shared_ptr<const OpeningBook> openings) { book = std::move(openings); }
+
+    // Endgame tables from tbgen, shared with other players
+    void setTablebase(std::shared_ptr<const Tablebase> tables) { tablebase = std::move(tables); }
+
+    // Int8 network from quantize, used by chooseMove in place of the float
+    // one. Training still updates the float network.
+    void setQuantizedNetwork(std::shared_ptr<const QuantizedNetwork> int8) { quantized = std::move(int8); }
     
     // Training methods
     void updateExperience(const std::vector<float>& state, int action, float reward,
@@ -11,6 +11,7 @@ int main(int argc, char* argv[]) {
     int numGames = 1000;
     bool graphics = false;
     bool visualize = true;  // Enable visualization by default
+    std::string recordFile;
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -21,23 +22,30 @@ int main(int argc, char* argv[]) {
             graphics = true;
         } else if (arg == "-novis") {
             visualize = false;
+        } else if (arg == "-record" && i + 1 < argc) {
+            recordFile = argv[++i];
         } else if (arg == "-help") {
             std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
             std::cout << "Options:" << std::endl;
             std::cout << "  -games N     Number of training games (default: 1000)" << std::endl;
             std::cout << "  -graphics    Enable graphics during training" << std::endl;
             std::cout << "  -novis       Disable training visualization" << std::endl;
+            std::cout << "  -record FILE Append every game's moves to FILE (for bookgen)" << std::endl;
             std::cout << "  -help        Show this help message" << std::endl;
             return 0;
         }
     }
     
-    // Create controller for AI training
-    Controller controller(2, graphics, false, false, true);  // 2 players, training mode
+    // Create controller for AI training, headless unless we want to watch
+    Controller controller(2, graphics, false, false, true, !graphics);  // 2 players, training mode
     
     // Set both players as AI
     controller.setAIPlayer(0, 0.005);  // Player 1 as AI with higher learning rate
     controller.setAIPlayer(1, 0.005);  // Player 2 as AI with higher learning rate
+
+    if (!recordFile.empty() && !controller.recordGames(recordFile)) {
+        return 1;
+    }
     
     std::cout << "Starting AI training with " << numGames << " games..." << std::endl;
     if (visualize) {
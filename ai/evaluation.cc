@@ -0,0 +1,43 @@
+#include "evaluation.h"
+
+#include "../game/bitboard.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+
+#include <cstdlib>
+
+
+namespace {
+    // Bonus for being d steps (ignoring water) from the den we attack
+    constexpr int ADVANCE_BONUS[] = {0, 300, 120, 70, 45, 30, 20, 12, 6, 2, 0, 0, 0, 0, 0, 0, 0};
+
+    int distance(int from, int to) {
+        return std::abs(GameState::toRow(from) - GameState::toRow(to))
+             + std::abs(GameState::toCol(from) - GameState::toCol(to));
+    }
+
+    int scoreSide(const GameState& state, int player) {
+        int den = Bitboard::lsb(state.denMask[player]);
+        int score = 0;
+
+        for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+            int square = state.pieceSquare[player][piece];
+            if (square < 0) continue;
+
+            score += Evaluation::PIECE_VALUE[piece];
+            score += ADVANCE_BONUS[distance(square, den)];
+
+            // A trapped piece can be taken by anything
+            if (state.isTrap(square)) {
+                score -= Evaluation::PIECE_VALUE[piece] / 4;
+            }
+        }
+        return score;
+    }
+}
+
+
+int Evaluation::evaluate(const GameState& state) {
+    int side = state.sideToMove;
+    return scoreSide(state, side) - scoreSide(state, side ^ 1);
+}
@@ -0,0 +1,28 @@
+#ifndef __EVALUATION_H__
+#define __EVALUATION_H__
+
+#include "../game/constants.h"
+
+struct GameState;
+
+// Hand-written static evaluation for the search players. Scores are from
+// the side to move's point of view, positive is good for them.
+namespace Evaluation {
+    // Beyond any positional score, a win found n plies from the root
+    // scores WIN_SCORE - n so shorter wins are preferred
+    constexpr int WIN_SCORE = 100000;
+    constexpr int MAX_PLY = 128;
+    constexpr int WIN_BOUND = WIN_SCORE - MAX_PLY;
+
+    // Material by piece index (rat .. elephant). The rat is worth more
+    // than its strength since it is the elephant's only threat.
+    constexpr int PIECE_VALUE[Constants::NUM_PIECES] = {450, 200, 300, 400, 550, 800, 900, 1000};
+
+    int evaluate(const GameState& state);
+
+    inline bool isWinScore(int score) {
+        return score >= WIN_BOUND || score <= -WIN_BOUND;
+    }
+}
+
+#endif
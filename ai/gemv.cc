@@ -0,0 +1,422 @@
+#include "gemv.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <immintrin.h>
+
+namespace {
+    // Rows done together, so each input load is shared by four rows and
+    // the horizontal sums are done four at a time
+    constexpr int ROWS = 4;
+
+    inline float activate(float sum, bool relu) {
+        return relu ? std::max(sum, 0.0f) : sum;
+    }
+
+    void scalarRow(const float* row, float bias, const float* input, int inputs, float* out, bool relu) {
+        float sum = bias;
+        for (int j = 0; j < inputs; ++j) {
+            sum += row[j] * input[j];
+        }
+        *out = activate(sum, relu);
+    }
+
+    // Adds the bias to four rows' sums, applies ReLU and stores them
+    inline void store4(__m128 sums, const float* bias, float* out, bool relu) {
+        sums = _mm_add_ps(sums, _mm_loadu_ps(bias));
+        if (relu) {
+            sums = _mm_max_ps(sums, _mm_setzero_ps());
+        }
+        _mm_storeu_ps(out, sums);
+    }
+
+    void gemvScalar(const float* weights, int stride, const float* bias,
+                    const float* input, int inputs, int outputs, float* out, bool relu) {
+        for (int i = 0; i < outputs; ++i) {
+            scalarRow(weights + static_cast<size_t>(i) * stride, bias[i], input, inputs, out + i, relu);
+        }
+    }
+
+    __attribute__((target("sse2")))
+    void gemvSSE2(const float* weights, int stride, const float* bias,
+                  const float* input, int inputs, int outputs, float* out, bool relu) {
+        int vectorEnd = inputs & ~3;
+        int i = 0;
+        for (; i + ROWS <= outputs; i += ROWS) {
+            const float* row = weights + static_cast<size_t>(i) * stride;
+            __m128 acc0 = _mm_setzero_ps();
+            __m128 acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps();
+            __m128 acc3 = _mm_setzero_ps();
+            for (int j = 0; j < vectorEnd; j += 4) {
+                __m128 x = _mm_loadu_ps(input + j);
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(row + j), x));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(row + stride + j), x));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_load_ps(row + 2 * stride + j), x));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_load_ps(row + 3 * stride + j), x));
+            }
+
+            // Lane k of the transposed sum is row k's total
+            _MM_TRANSPOSE4_PS(acc0, acc1, acc2, acc3);
+            __m128 sums = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+
+            float tail[ROWS] = {};
+            for (int j = vectorEnd; j < inputs; ++j) {
+                for (int k = 0; k < ROWS; ++k) {
+                    tail[k] += row[k * stride + j] * input[j];
+                }
+            }
+            store4(_mm_add_ps(sums, _mm_loadu_ps(tail)), bias + i, out + i, relu);
+        }
+        for (; i < outputs; ++i) {
+            scalarRow(weights + static_cast<size_t>(i) * stride, bias[i], input, inputs, out + i, relu);
+        }
+    }
+
+    // Pairwise adds leave each row's halves in the two 128 bit lanes
+    __attribute__((target("avx2")))
+    inline __m128 sum4(__m256 row0, __m256 row1, __m256 row2, __m256 row3) {
+        __m256 sums = _mm256_hadd_ps(_mm256_hadd_ps(row0, row1), _mm256_hadd_ps(row2, row3));
+        return _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+    }
+
+    __attribute__((target("avx2,fma")))
+    void gemvAVX2(const float* weights, int stride, const float* bias,
+                  const float* input, int inputs, int outputs, float* out, bool relu) {
+        int vectorEnd = inputs & ~7;
+
+        // The last partial vector of input, zeros past the end
+        alignas(32) static const int MASK_SOURCE[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+        __m256i tailMask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(MASK_SOURCE + 8 - (inputs - vectorEnd)));
+        __m256 tailInput = _mm256_maskload_ps(input + vectorEnd, tailMask);
+
+        int i = 0;
+        for (; i + ROWS <= outputs; i += ROWS) {
+            const float* row = weights + static_cast<size_t>(i) * stride;
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps();
+            __m256 acc3 = _mm256_setzero_ps();
+            for (int j = 0; j < vectorEnd; j += 8) {
+                __m256 x = _mm256_loadu_ps(input + j);
+                acc0 = _mm256_fmadd_ps(_mm256_load_ps(row + j), x, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_load_ps(row + stride + j), x, acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_load_ps(row + 2 * stride + j), x, acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_load_ps(row + 3 * stride + j), x, acc3);
+            }
+            if (vectorEnd < inputs) {
+                // Rows are padded to whole cache lines, so the full load
+                // stays inside the block
+                acc0 = _mm256_fmadd_ps(_mm256_load_ps(row + vectorEnd), tailInput, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_load_ps(row + stride + vectorEnd), tailInput, acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_load_ps(row + 2 * stride + vectorEnd), tailInput, acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_load_ps(row + 3 * stride + vectorEnd), tailInput, acc3);
+            }
+
+            store4(sum4(acc0, acc1, acc2, acc3), bias + i, out + i, relu);
+        }
+        for (; i < outputs; ++i) {
+            scalarRow(weights + static_cast<size_t>(i) * stride, bias[i], input, inputs, out + i, relu);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void gemvAVX512(const float* weights, int stride, const float* bias,
+                    const float* input, int inputs, int outputs, float* out, bool relu) {
+        int vectorEnd = inputs & ~15;
+        __mmask16 tailMask = static_cast<__mmask16>((1u << (inputs - vectorEnd)) - 1);
+        __m512 tailInput = _mm512_maskz_loadu_ps(tailMask, input + vectorEnd);
+
+        int i = 0;
+        for (; i + ROWS <= outputs; i += ROWS) {
+            const float* row = weights + static_cast<size_t>(i) * stride;
+            __m512 acc0 = _mm512_setzero_ps();
+            __m512 acc1 = _mm512_setzero_ps();
+            __m512 acc2 = _mm512_setzero_ps();
+            __m512 acc3 = _mm512_setzero_ps();
+            for (int j = 0; j < vectorEnd; j += 16) {
+                __m512 x = _mm512_loadu_ps(input + j);
+                acc0 = _mm512_fmadd_ps(_mm512_load_ps(row + j), x, acc0);
+                acc1 = _mm512_fmadd_ps(_mm512_load_ps(row + stride + j), x, acc1);
+                acc2 = _mm512_fmadd_ps(_mm512_load_ps(row + 2 * stride + j), x, acc2);
+                acc3 = _mm512_fmadd_ps(_mm512_load_ps(row + 3 * stride + j), x, acc3);
+            }
+            if (vectorEnd < inputs) {
+                acc0 = _mm512_fmadd_ps(_mm512_load_ps(row + vectorEnd), tailInput, acc0);
+                acc1 = _mm512_fmadd_ps(_mm512_load_ps(row + stride + vectorEnd), tailInput, acc1);
+                acc2 = _mm512_fmadd_ps(_mm512_load_ps(row + 2 * stride + vectorEnd), tailInput, acc2);
+                acc3 = _mm512_fmadd_ps(_mm512_load_ps(row + 3 * stride + vectorEnd), tailInput, acc3);
+            }
+
+            store4(sum4(Simd::fold(acc0), Simd::fold(acc1), Simd::fold(acc2), Simd::fold(acc3)), bias + i, out + i, relu);
+        }
+        for (; i < outputs; ++i) {
+            scalarRow(weights + static_cast<size_t>(i) * stride, bias[i], input, inputs, out + i, relu);
+        }
+    }
+
+    // The batched kernels hold the inputs and outputs one row per neuron and
+    // one column per input, so each step of the inner loop is a weight
+    // broadcast times a row of inputs: no horizontal sums, and each weight
+    // is loaded once per block of columns. Blocks are BlockRows rows by
+    // Vectors vectors of columns, all sums held in registers. The sums
+    // run in the scalar kernel's order, only FMA rounding differs.
+    void gemmScalar(const float* weights, int stride, const float* bias, const float* input,
+                    int inputs, int outputs, float* out, int columns, bool relu) {
+        for (int i = 0; i < outputs; ++i) {
+            const float* row = weights + static_cast<size_t>(i) * stride;
+            float* sums = out + static_cast<size_t>(i) * columns;
+            std::fill(sums, sums + columns, bias[i]);
+            for (int j = 0; j < inputs; ++j) {
+                const float* x = input + static_cast<size_t>(j) * columns;
+                for (int c = 0; c < columns; ++c) {
+                    sums[c] += row[j] * x[c];
+                }
+            }
+            for (int c = 0; c < columns; ++c) {
+                sums[c] = activate(sums[c], relu);
+            }
+        }
+    }
+
+    template <int BlockRows, int Vectors>
+    __attribute__((target("sse2"), always_inline))
+    inline void blockSSE2(const float* weights, int stride, const float* bias, const float* input,
+                          int inputs, float* out, int columns, bool relu) {
+        __m128 acc[BlockRows][Vectors];
+        #pragma GCC unroll 8
+        for (int r = 0; r < BlockRows; ++r) {
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                acc[r][v] = _mm_set1_ps(bias[r]);
+            }
+        }
+        for (int j = 0; j < inputs; ++j) {
+            __m128 x[Vectors];
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                x[v] = _mm_load_ps(input + static_cast<size_t>(j) * columns + 4 * v);
+            }
+            #pragma GCC unroll 8
+            for (int r = 0; r < BlockRows; ++r) {
+                __m128 w = _mm_set1_ps(weights[static_cast<size_t>(r) * stride + j]);
+                #pragma GCC unroll 8
+                for (int v = 0; v < Vectors; ++v) {
+                    acc[r][v] = _mm_add_ps(acc[r][v], _mm_mul_ps(w, x[v]));
+                }
+            }
+        }
+        #pragma GCC unroll 8
+        for (int r = 0; r < BlockRows; ++r) {
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                __m128 sum = relu ? _mm_max_ps(acc[r][v], _mm_setzero_ps()) : acc[r][v];
+                _mm_store_ps(out + static_cast<size_t>(r) * columns + 4 * v, sum);
+            }
+        }
+    }
+
+    __attribute__((target("sse2")))
+    void gemmSSE2(const float* weights, int stride, const float* bias, const float* input,
+                  int inputs, int outputs, float* out, int columns, bool relu) {
+        // Columns come in whole cache lines, four vectors
+        for (int c = 0; c < columns; c += 16) {
+            int i = 0;
+            for (; i + 2 <= outputs; i += 2) {
+                blockSSE2<2, 4>(weights + static_cast<size_t>(i) * stride, stride, bias + i, input + c,
+                                inputs, out + static_cast<size_t>(i) * columns + c, columns, relu);
+            }
+            for (; i < outputs; ++i) {
+                blockSSE2<1, 4>(weights + static_cast<size_t>(i) * stride, stride, bias + i, input + c,
+                                inputs, out + static_cast<size_t>(i) * columns + c, columns, relu);
+            }
+        }
+    }
+
+    template <int BlockRows, int Vectors>
+    __attribute__((target("avx2,fma"), always_inline))
+    inline void blockAVX2(const float* weights, int stride, const float* bias, const float* input,
+                          int inputs, float* out, int columns, bool relu) {
+        __m256 acc[BlockRows][Vectors];
+        #pragma GCC unroll 8
+        for (int r = 0; r < BlockRows; ++r) {
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                acc[r][v] = _mm256_set1_ps(bias[r]);
+            }
+        }
+        for (int j = 0; j < inputs; ++j) {
+            __m256 x[Vectors];
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                x[v] = _mm256_load_ps(input + static_cast<size_t>(j) * columns + 8 * v);
+            }
+            #pragma GCC unroll 8
+            for (int r = 0; r < BlockRows; ++r) {
+                __m256 w = _mm256_broadcast_ss(weights + static_cast<size_t>(r) * stride + j);
+                #pragma GCC unroll 8
+                for (int v = 0; v < Vectors; ++v) {
+                    acc[r][v] = _mm256_fmadd_ps(w, x[v], acc[r][v]);
+                }
+            }
+        }
+        #pragma GCC unroll 8
+        for (int r = 0; r < BlockRows; ++r) {
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                __m256 sum = relu ? _mm256_max_ps(acc[r][v], _mm256_setzero_ps()) : acc[r][v];
+                _mm256_store_ps(out + static_cast<size_t>(r) * columns + 8 * v, sum);
+            }
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void gemmAVX2(const float* weights, int stride, const float* bias, const float* input,
+                  int inputs, int outputs, float* out, int columns, bool relu) {
+        for (int c = 0; c < columns; c += 16) {
+            int i = 0;
+            for (; i + 6 <= outputs; i += 6) {
+                blockAVX2<6, 2>(weights + static_cast<size_t>(i) * stride, stride, bias + i, input + c,
+                                inputs, out + static_cast<size_t>(i) * columns + c, columns, relu);
+            }
+            for (; i < outputs; ++i) {
+                blockAVX2<1, 2>(weights + static_cast<size_t>(i) * stride, stride, bias + i, input + c,
+                                inputs, out + static_cast<size_t>(i) * columns + c, columns, relu);
+            }
+        }
+    }
+
+    template <int BlockRows, int Vectors>
+    __attribute__((target("avx512f"), always_inline))
+    inline void blockAVX512(const float* weights, int stride, const float* bias, const float* input,
+                            int inputs, float* out, int columns, bool relu) {
+        __m512 acc[BlockRows][Vectors];
+        #pragma GCC unroll 8
+        for (int r = 0; r < BlockRows; ++r) {
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                acc[r][v] = _mm512_set1_ps(bias[r]);
+            }
+        }
+        for (int j = 0; j < inputs; ++j) {
+            __m512 x[Vectors];
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                x[v] = _mm512_load_ps(input + static_cast<size_t>(j) * columns + 16 * v);
+            }
+            #pragma GCC unroll 8
+            for (int r = 0; r < BlockRows; ++r) {
+                __m512 w = _mm512_set1_ps(weights[static_cast<size_t>(r) * stride + j]);
+                #pragma GCC unroll 8
+                for (int v = 0; v < Vectors; ++v) {
+                    acc[r][v] = _mm512_fmadd_ps(w, x[v], acc[r][v]);
+                }
+            }
+        }
+        #pragma GCC unroll 8
+        for (int r = 0; r < BlockRows; ++r) {
+            #pragma GCC unroll 8
+            for (int v = 0; v < Vectors; ++v) {
+                // ReLU by zeroing the lanes that aren't positive, for the
+                // same reason as Simd::fold
+                __mmask16 keep = relu ? _mm512_cmp_ps_mask(acc[r][v], _mm512_setzero_ps(), _CMP_GT_OQ) : 0xffff;
+                __m512 sum = _mm512_maskz_mov_ps(keep, acc[r][v]);
+                _mm512_store_ps(out + static_cast<size_t>(r) * columns + 16 * v, sum);
+            }
+        }
+    }
+
+    template <int Vectors>
+    __attribute__((target("avx512f"), always_inline))
+    inline void rowsAVX512(const float* weights, int stride, const float* bias, const float* input,
+                           int inputs, int outputs, float* out, int columns, bool relu) {
+        int i = 0;
+        for (; i + 8 <= outputs; i += 8) {
+            blockAVX512<8, Vectors>(weights + static_cast<size_t>(i) * stride, stride, bias + i, input,
+                                    inputs, out + static_cast<size_t>(i) * columns, columns, relu);
+        }
+        for (; i < outputs; ++i) {
+            blockAVX512<1, Vectors>(weights + static_cast<size_t>(i) * stride, stride, bias + i, input,
+                                    inputs, out + static_cast<size_t>(i) * columns, columns, relu);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void gemmAVX512(const float* weights, int stride, const float* bias, const float* input,
+                    int inputs, int outputs, float* out, int columns, bool relu) {
+        int c = 0;
+        for (; c + 32 <= columns; c += 32) {
+            rowsAVX512<2>(weights, stride, bias, input + c, inputs, outputs, out + c, columns, relu);
+        }
+        if (c < columns) {
+            rowsAVX512<1>(weights, stride, bias, input + c, inputs, outputs, out + c, columns, relu);
+        }
+    }
+}
+
+namespace Gemv {
+    const char* getName(Isa isa) {
+        switch (isa) {
+            case Isa::Scalar: return "scalar";
+            case Isa::SSE2: return "sse2";
+            case Isa::AVX2: return "avx2";
+            case Isa::AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    bool isSupported(Isa isa) {
+        __builtin_cpu_init();
+        switch (isa) {
+            case Isa::Scalar: return true;
+            case Isa::SSE2: return __builtin_cpu_supports("sse2");
+            case Isa::AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            case Isa::AVX512: return __builtin_cpu_supports("avx512f");
+        }
+        return false;
+    }
+
+    Kernel getKernel(Isa isa) {
+        if (!isSupported(isa)) return nullptr;
+
+        switch (isa) {
+            case Isa::Scalar: return gemvScalar;
+            case Isa::SSE2: return gemvSSE2;
+            case Isa::AVX2: return gemvAVX2;
+            case Isa::AVX512: return gemvAVX512;
+        }
+        return nullptr;
+    }
+
+    BatchKernel getBatchKernel(Isa isa) {
+        if (!isSupported(isa)) return nullptr;
+
+        switch (isa) {
+            case Isa::Scalar: return gemmScalar;
+            case Isa::SSE2: return gemmSSE2;
+            case Isa::AVX2: return gemmAVX2;
+            case Isa::AVX512: return gemmAVX512;
+        }
+        return nullptr;
+    }
+
+    Isa getBestIsa() {
+        static const Isa best = [] {
+            for (Isa isa : {Isa::AVX512, Isa::AVX2, Isa::SSE2}) {
+                if (isSupported(isa)) return isa;
+            }
+            return Isa::Scalar;
+        }();
+        return best;
+    }
+
+    void forward(const NetworkLayer& layer, const float* input, float* out, bool relu) {
+        static const Kernel kernel = getKernel(getBestIsa());
+        kernel(layer.row(0), layer.stride, layer.biases(), input, layer.inputs, layer.outputs, out, relu);
+    }
+
+    void forwardBatch(const NetworkLayer& layer, const float* input, float* out, int columns, bool relu) {
+        static const BatchKernel kernel = getBatchKernel(getBestIsa());
+        kernel(layer.row(0), layer.stride, layer.biases(), input, layer.inputs, layer.outputs, out, columns, relu);
+    }
+}
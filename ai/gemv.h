@@ -0,0 +1,49 @@
+#ifndef __GEMV_H__
+#define __GEMV_H__
+
+#include "ainetwork.h"
+
+// Matrix-vector products for one network layer, and matrix-matrix ones for
+// a batch of inputs, with the bias and ReLU done in the same pass:
+// out = max(0, W in + b), or without the max for the output layer. There
+// is a kernel per instruction set, picked at run time from what the CPU
+// reports, and a scalar one that runs everywhere. The vector kernels add
+// in a different order, so they agree with the scalar one to rounding,
+// not bit for bit.
+namespace Gemv {
+    enum class Isa {
+        Scalar,
+        SSE2,
+        AVX2,     // with FMA
+        AVX512
+    };
+
+    constexpr int NUM_ISAS = 4;
+
+    // weights is the layer block (rows stride floats apart, 64 byte
+    // aligned), input holds inputs floats and out outputs floats
+    using Kernel = void (*)(const float* weights, int stride, const float* bias,
+                            const float* input, int inputs, int outputs, float* out, bool relu);
+
+    // The same over a batch, held transposed: input is inputs rows and out
+    // outputs rows of columns floats, one column per input. columns is a
+    // multiple of NetworkLayer::FLOATS_PER_LINE and both are 64 byte
+    // aligned; padding columns get computed like the rest.
+    using BatchKernel = void (*)(const float* weights, int stride, const float* bias,
+                                 const float* input, int inputs, int outputs,
+                                 float* out, int columns, bool relu);
+
+    const char* getName(Isa isa);
+    bool isSupported(Isa isa);
+    // nullptr when the CPU can't run it
+    Kernel getKernel(Isa isa);
+    BatchKernel getBatchKernel(Isa isa);
+    // Widest instruction set the CPU supports, worked out once
+    Isa getBestIsa();
+
+    // One layer through the best kernel
+    void forward(const NetworkLayer& layer, const float* input, float* out, bool relu);
+    void forwardBatch(const NetworkLayer& layer, const float* input, float* out, int columns, bool relu);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include "mappedfile.h"
+
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open " << filename << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        std::cerr << "Error: " << filename << " is empty" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Error: Could not map " << filename << std::endl;
+        return false;
+    }
+
+    mapping = data;
+    size = info.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        munmap(mapping, size);
+        mapping = nullptr;
+        size = 0;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only mmap of a whole file, for tables that are looked up in place
+// instead of being read into memory
+class MappedFile {
+private:
+    void* mapping;
+    size_t size;
+
+public:
+    MappedFile() : mapping(nullptr), size(0) {}
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False (with a message) if the file can't be opened or is empty
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    const uint8_t* getData() const { return static_cast<const uint8_t*>(mapping); }
+    size_t getSize() const { return size; }
+};
+
+#endif
@@ -0,0 +1,604 @@
+#include "mctsplayer.h"
+#include "aiplayer.h"
+#include "ainetwork.h"
+#include "evaluation.h"
+#include "openingbook.h"
+#include "../game/board.h"
+#include "../game/gamestate.h"
+#include "../game/zobrist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace {
+    // Exploration weight in the PUCT formula
+    constexpr float C_PUCT = 1.5f;
+
+    // DQN Q-values are rewards (a win is worth 200). Priors are a softmax
+    // over Q / PRIOR_TEMPERATURE, values are tanh(Q / VALUE_SCALE).
+    constexpr float PRIOR_TEMPERATURE = 10.0f;
+    constexpr float VALUE_SCALE = 100.0f;
+
+    // Static evaluation to value, without a network
+    constexpr float EVAL_SCALE = 1000.0f;
+
+    constexpr int MAX_BATCH = 256;
+    // Share of the memory set aside for moving the reused subtree, 1 / this
+    constexpr size_t REUSE_SHARE = 16;
+
+    // A pool full before this share of the search gets a warning. Filling
+    // later costs little, the last playouts only sharpen the visit counts.
+    constexpr double EARLY_FULL = 0.5;
+
+    // How long the evaluator waits for a batch to fill before taking what is queued
+    constexpr std::chrono::milliseconds BATCH_WAIT{1};
+
+    // std::atomic<float> has no fetch_add before C++20
+    void addValue(std::atomic<float>& sum, float value) {
+        float old = sum.load(std::memory_order_relaxed);
+        while (!sum.compare_exchange_weak(old, old + value, std::memory_order_relaxed)) {}
+    }
+
+    bool samePosition(const GameState& a, const GameState& b) {
+        return a.hash == b.hash && a.sideToMove == b.sideToMove && a.winner == b.winner &&
+               std::memcmp(a.pieceSquare, b.pieceSquare, sizeof(a.pieceSquare)) == 0;
+    }
+}
+
+constexpr size_t MCTSPlayer::DEFAULT_MEMORY_MB;
+
+MCTSPlayer::MCTSPlayer(int index, char startingPiece, int moveTimeMs, size_t memoryMb)
+    : Player(index, startingPiece),
+      moveTimeMs(moveTimeMs),
+      maxPlayouts(0),
+      verbose(true),
+      threads(1),
+      batchSize(1),
+      hasTree(false),
+      rootState{},
+      lastStats{},
+      queuedCount(0),
+      waitingWorkers(0),
+      stopping(false),
+      playoutCount(0),
+      batchCount(0),
+      collisionCount(0),
+      fullAfter(0.0)
+{
+    // The subtree kept after our move and the reply is usually well under
+    // 1% of the last tree, so the reuse pool gets a sixteenth
+    size_t capacity = memoryMb * 1024 * 1024 / sizeof(MCTSNode);
+    size_t reuseCapacity = std::max<size_t>(capacity / REUSE_SHARE, Constants::MAX_MOVES + 1);
+    nodes = MCTSNodePool(std::max<size_t>(capacity - std::min(capacity, reuseCapacity), Constants::MAX_MOVES + 1));
+    reusePool = MCTSNodePool(reuseCapacity);
+
+    path.reserve(Evaluation::MAX_PLY);
+}
+
+MCTSPlayer::~MCTSPlayer() = default;
+
+void MCTSPlayer::setThreads(int count) {
+    threads = std::max(count, 1);
+}
+
+void MCTSPlayer::setBatchSize(int size) {
+    batchSize = std::min(std::max(size, 1), MAX_BATCH);
+}
+
+void MCTSPlayer::useNetwork(const std::string& modelFile) {
+    network = std::make_unique<AINetwork>(AIPlayer::getNetworkLayers());
+    network->loadFromFile(modelFile);
+}
+
+Move MCTSPlayer::chooseMove(Board* board, const MoveList& legalMoves) {
+    GameState root = board->saveState();
+    if (root.sideToMove != getIndex()) {
+        root.sideToMove = getIndex();
+        root.hash = Zobrist::hash(root);
+    }
+
+    Move bookMove;
+    BookEntry bookStats;
+    if (book && book->probe(root, bookMove, bookStats)) {
+        for (const Move& move : legalMoves) {
+            if (move == bookMove) {
+                if (verbose) {
+                    std::cout << "book " << move.getPieceId() << move.getDirection() << " played " << bookStats.games
+                              << " times, scoring " << bookStats.getScore() * 100 << "%" << std::endl;
+                }
+                return move;
+            }
+        }
+    }
+
+    MCTSStats stats = search(root);
+
+    for (const Move& move : legalMoves) {
+        if (move == stats.bestMove) {
+            return move;
+        }
+    }
+    return legalMoves[0];
+}
+
+MCTSStats MCTSPlayer::search(const GameState& root) {
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(moveTimeMs);
+
+    searchStart = start;
+    fullAfter = 0.0;
+
+    MCTSStats stats{};
+    stats.nodesReused = reuseTree(root) ? nodes.getUsed() : 0;
+
+    if (!stats.nodesReused) {
+        nodes.clear();
+        int32_t rootIndex = nodes.allocate(1);
+        nodes[rootIndex] = MCTSNode(Move{}, 1.0f);
+        rootState = root;
+        hasTree = true;
+    }
+
+    if (threads > 1 || batchSize > 1) {
+        parallelSearch(deadline);
+        stats.playouts = playoutCount;
+        stats.batches = batchCount;
+        stats.collisions = collisionCount;
+    }
+    else {
+        // Keep going until time runs out, at least once so the root has children
+        do {
+            playout();
+            stats.playouts++;
+        } while ((maxPlayouts <= 0 || stats.playouts < static_cast<uint64_t>(maxPlayouts)) &&
+                 (moveTimeMs <= 0 || std::chrono::steady_clock::now() < deadline));
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.nodesUsed = nodes.getUsed();
+    stats.fullAfter = fullAfter;
+    stats.memoryBytes = (nodes.getCapacity() + reusePool.getCapacity()) * sizeof(MCTSNode);
+
+    // Play the most visited move
+    const MCTSNode& rootNode = nodes[0];
+    int32_t best = -1;
+    for (int i = 0; i < rootNode.childCount; i++) {
+        int32_t child = rootNode.firstChild + i;
+        if (best < 0 || nodes[child].visits > nodes[best].visits) {
+            best = child;
+        }
+    }
+
+    if (best >= 0) {
+        const MCTSNode& bestNode = nodes[best];
+        stats.bestMove = bestNode.move;
+        stats.bestVisits = bestNode.visits;
+        stats.bestValue = bestNode.visits ? bestNode.valueSum / bestNode.visits : 0.0f;
+    }
+
+    if (verbose) {
+        std::cout << "mcts playouts " << stats.playouts
+                  << " (" << static_cast<uint64_t>(stats.getPlayoutsPerSecond()) << "/s)"
+                  << " nodes " << stats.nodesUsed << "/" << nodes.getCapacity()
+                  << " reused " << stats.nodesReused
+                  << " memory " << stats.memoryBytes / (1024 * 1024) << "MB";
+        if (stats.batches) {
+            std::cout << " threads " << threads << " batch " << stats.getAverageBatch()
+                      << " collisions " << stats.collisions;
+        }
+        std::cout << " best " << stats.bestMove.getPieceId() << stats.bestMove.getDirection()
+                  << " visits " << stats.bestVisits << " value " << stats.bestValue << std::endl;
+        if (stats.fullAfter > 0 && stats.fullAfter < stats.seconds * EARLY_FULL) {
+            std::cout << "Warning: mcts node pool full after " << static_cast<int>(stats.fullAfter * 1000)
+                      << "ms of " << static_cast<int>(stats.seconds * 1000) << "ms, no new nodes after that;"
+                      << " raise -hash" << std::endl;
+        }
+    }
+
+    lastStats = stats;
+    return stats;
+}
+
+void MCTSPlayer::playout() {
+    GameState state = rootState;
+    path.clear();
+    path.push_back(0);
+
+    // Walk down to a leaf
+    int32_t node = 0;
+    while (nodes[node].firstChild >= 0) {
+        node = selectChild(node);
+        state.play(nodes[node].move);
+        path.push_back(node);
+    }
+
+    // Value for the side to move at the leaf
+    float value;
+    if (state.isGameOver() || nodes[node].terminal) {
+        value = -1.0f;
+    }
+    else {
+        value = expand(node, state);
+    }
+
+    backup(path, value, false);
+}
+
+void MCTSPlayer::parallelSearch(std::chrono::steady_clock::time_point deadline) {
+    queued.resize(batchSize);
+    evaluating.resize(batchSize);
+    for (LeafRequest& request : queued) request.path.reserve(Evaluation::MAX_PLY);
+    for (LeafRequest& request : evaluating) request.path.reserve(Evaluation::MAX_PLY);
+
+    queuedCount = 0;
+    waitingWorkers = 0;
+    stopping = false;
+    playoutCount = 0;
+    batchCount = 0;
+    collisionCount = 0;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&MCTSPlayer::parallelWorker, this);
+    }
+
+    // This thread is the evaluator
+    bool done = false;
+    while (!done) {
+        int count;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            // A full batch, or every worker stuck waiting on queued leaves
+            batchReady.wait_for(lock, BATCH_WAIT, [&] {
+                return queuedCount == batchSize || (queuedCount > 0 && waitingWorkers == threads);
+            });
+
+            // Stop once the root has children and the time or playouts are used up
+            const MCTSNode& rootNode = nodes[0];
+            bool rootSearched = rootNode.firstChild >= 0 || rootNode.terminal;
+            bool limitReached = (maxPlayouts > 0 && playoutCount >= static_cast<uint64_t>(maxPlayouts)) ||
+                                (moveTimeMs > 0 && std::chrono::steady_clock::now() >= deadline);
+            done = rootSearched && limitReached;
+            stopping = done;
+
+            std::swap(queued, evaluating);
+            count = queuedCount;
+            queuedCount = 0;
+        }
+        batchDone.notify_all();
+
+        if (count == 0) continue;
+        evaluateBatch(evaluating, count);
+
+        // The workers keep walking meanwhile, this is the only thread that adds nodes
+        for (int i = 0; i < count; i++) {
+            LeafRequest& request = evaluating[i];
+            MCTSNode& leaf = nodes[request.node];
+            if (request.moves.empty()) {
+                leaf.terminal.store(true, std::memory_order_relaxed);
+            }
+            else if (leaf.firstChild.load(std::memory_order_relaxed) < 0) {
+                // A walk that reached the leaf just before an earlier batch
+                // expanded it can queue it again, it only gets the backup
+                attachChildren(request.node, request.moves, request.priors);
+            }
+            backup(request.path, request.value, true);
+        }
+        playoutCount += count;
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            batchCount++;
+        }
+        batchDone.notify_all();
+    }
+
+    // Workers queue nothing once stopping is set, so no virtual loss is left
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void MCTSPlayer::parallelWorker() {
+    std::vector<int32_t> workerPath;
+    workerPath.reserve(Evaluation::MAX_PLY);
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        // A leaf someone else has queued gets its batch counted after this
+        uint64_t batch = batchCount;
+
+        GameState state = rootState;
+        workerPath.clear();
+        workerPath.push_back(0);
+        int pending = nodes[0].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+
+        int32_t node = 0;
+        while (nodes[node].firstChild.load(std::memory_order_acquire) >= 0) {
+            node = selectChild(node);
+            state.play(nodes[node].move);
+            workerPath.push_back(node);
+            pending = nodes[node].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (state.isGameOver() || nodes[node].terminal.load(std::memory_order_relaxed)) {
+            backup(workerPath, -1.0f, true);
+            playoutCount++;
+            continue;
+        }
+
+        // Someone else already queued this leaf, back off until the next batch lands
+        if (pending > 0) {
+            for (int32_t visited : workerPath) {
+                nodes[visited].virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+            }
+            collisionCount++;
+
+            std::unique_lock<std::mutex> lock(queueMutex);
+            waitingWorkers++;
+            batchReady.notify_one();
+            batchDone.wait(lock, [&] { return stopping || batchCount != batch; });
+            waitingWorkers--;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (queuedCount == batchSize) {
+            waitingWorkers++;
+            batchReady.notify_one();
+            batchDone.wait(lock, [&] { return stopping || queuedCount < batchSize; });
+            waitingWorkers--;
+        }
+
+        if (stopping) {
+            for (int32_t visited : workerPath) {
+                nodes[visited].virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+            }
+            break;
+        }
+
+        LeafRequest& request = queued[queuedCount++];
+        request.node = node;
+        request.state = state;
+        request.path.assign(workerPath.begin(), workerPath.end());
+        if (queuedCount == batchSize) {
+            batchReady.notify_one();
+        }
+    }
+}
+
+void MCTSPlayer::backup(const std::vector<int32_t>& branch, float value, bool virtualLoss) {
+    // Each node keeps the value for the player who moved into it
+    for (int i = branch.size() - 1; i >= 0; i--) {
+        MCTSNode& visited = nodes[branch[i]];
+        if (virtualLoss) {
+            visited.visits.fetch_add(1, std::memory_order_relaxed);
+            addValue(visited.valueSum, -value);
+            visited.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else {
+            // Single threaded, nothing else writes the tree
+            visited.visits.store(visited.visits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            visited.valueSum.store(visited.valueSum.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+        }
+        value = -value;
+    }
+}
+
+int32_t MCTSPlayer::selectChild(int32_t parent) {
+    // Other walkers update the counts as this reads them, a slightly stale
+    // mix only nudges the scores
+    const MCTSNode& parentNode = nodes[parent];
+    int32_t first = parentNode.firstChild.load(std::memory_order_acquire);
+    int parentVisits = parentNode.visits.load(std::memory_order_relaxed) +
+                       parentNode.virtualLoss.load(std::memory_order_relaxed);
+    float exploration = C_PUCT * std::sqrt(static_cast<float>(parentVisits));
+
+    int32_t best = first;
+    float bestScore = -1e30f;
+
+    for (int i = 0; i < parentNode.childCount; i++) {
+        int32_t childIndex = first + i;
+        const MCTSNode& child = nodes[childIndex];
+
+        // A pending playout counts as a loss until its value arrives
+        int virtualLoss = child.virtualLoss.load(std::memory_order_relaxed);
+        int visits = child.visits.load(std::memory_order_relaxed) + virtualLoss;
+        float q = visits ? (child.valueSum.load(std::memory_order_relaxed) - virtualLoss) / visits : 0.0f;
+        float score = q + exploration * child.prior / (1 + visits);
+        if (score > bestScore) {
+            bestScore = score;
+            best = childIndex;
+        }
+    }
+    return best;
+}
+
+float MCTSPlayer::expand(int32_t nodeIndex, const GameState& state) {
+    MoveList moves;
+    float priors[Constants::MAX_MOVES];
+    float value = evaluateLeaf(state, moves, priors);
+
+    if (moves.empty()) {
+        nodes[nodeIndex].terminal = true;
+    }
+    else {
+        attachChildren(nodeIndex, moves, priors);
+    }
+    return value;
+}
+
+float MCTSPlayer::evaluateLeaf(const GameState& state, MoveList& moves, float* priors) {
+    moves.clear();
+    state.generateMoves(moves);
+
+    if (moves.empty()) {
+        return -1.0f;
+    }
+
+    if (network) {
+        networkInput.resize(network->getInputSize());
+        networkOutput.resize(network->getOutputSize());
+        AIPlayer::moverToVector(state, networkInput.data());
+        network->predict(networkInput.data(), networkOutput.data());
+        return networkPriors(networkOutput.data(), state.sideToMove, moves, priors);
+    }
+
+    for (int i = 0; i < moves.size(); i++) {
+        priors[i] = 1.0f / moves.size();
+    }
+    return std::tanh(Evaluation::evaluate(state) / EVAL_SCALE);
+}
+
+float MCTSPlayer::networkPriors(const float* qValues, int side, const MoveList& moves, float* priors) {
+    float maxQ = qValues[AIPlayer::moverActionIndex(side, moves[0])];
+    for (const Move& move : moves) {
+        maxQ = std::max(maxQ, qValues[AIPlayer::moverActionIndex(side, move)]);
+    }
+
+    float total = 0.0f;
+    for (int i = 0; i < moves.size(); i++) {
+        priors[i] = std::exp((qValues[AIPlayer::moverActionIndex(side, moves[i])] - maxQ) / PRIOR_TEMPERATURE);
+        total += priors[i];
+    }
+    for (int i = 0; i < moves.size(); i++) {
+        priors[i] /= total;
+    }
+
+    return std::tanh(maxQ / VALUE_SCALE);
+}
+
+void MCTSPlayer::evaluateBatch(std::vector<LeafRequest>& requests, int count) {
+    if (!network) {
+        for (int i = 0; i < count; i++) {
+            LeafRequest& request = requests[i];
+            request.value = evaluateLeaf(request.state, request.moves, request.priors);
+        }
+        return;
+    }
+
+    // Leaves with moves go through the network together, as one batch
+    int inputSize = network->getInputSize();
+    int actionCount = network->getOutputSize();
+    networkInput.resize(static_cast<size_t>(count) * inputSize);
+    networkOutput.resize(static_cast<size_t>(count) * actionCount);
+    pending.clear();
+    for (int i = 0; i < count; i++) {
+        LeafRequest& request = requests[i];
+        request.moves.clear();
+        request.state.generateMoves(request.moves);
+        if (request.moves.empty()) {
+            request.value = -1.0f;
+            continue;
+        }
+
+        AIPlayer::moverToVector(request.state, networkInput.data() + pending.size() * inputSize);
+        pending.push_back(i);
+    }
+    if (pending.empty()) return;
+
+    network->predictBatch(networkInput.data(), pending.size(), networkOutput.data());
+    for (size_t k = 0; k < pending.size(); k++) {
+        LeafRequest& request = requests[pending[k]];
+        request.value = networkPriors(networkOutput.data() + k * actionCount, request.state.sideToMove,
+                                      request.moves, request.priors);
+    }
+}
+
+void MCTSPlayer::attachChildren(int32_t nodeIndex, const MoveList& moves, const float* priors) {
+    // A full pool still gives a value, the leaf just stays a leaf
+    int32_t first = nodes.allocate(moves.size());
+    if (first < 0) {
+        if (fullAfter == 0.0) {
+            fullAfter = std::chrono::duration<double>(std::chrono::steady_clock::now() - searchStart).count();
+        }
+        return;
+    }
+
+    // Built in place, assigning would copy the atomics one at a time
+    for (int i = 0; i < moves.size(); i++) {
+        new (&nodes[first + i]) MCTSNode(moves[i], priors[i]);
+    }
+
+    // Walkers only look at the children once firstChild is set
+    MCTSNode& node = nodes[nodeIndex];
+    node.childCount = moves.size();
+    node.firstChild.store(first, std::memory_order_release);
+}
+
+bool MCTSPlayer::reuseTree(const GameState& root) {
+    if (!hasTree) return false;
+
+    int32_t found = findDescendant(root);
+    if (found < 0) return false;
+    if (found == 0) return true;
+
+    copySubtree(found);
+    rootState = root;
+    return true;
+}
+
+int32_t MCTSPlayer::findDescendant(const GameState& root) {
+    if (samePosition(rootState, root)) return 0;
+
+    // Our move, then the opponent's reply
+    const MCTSNode& rootNode = nodes[0];
+    for (int i = 0; i < rootNode.childCount; i++) {
+        int32_t child = rootNode.firstChild + i;
+        GameState afterOurs = rootState;
+        afterOurs.play(nodes[child].move);
+        if (samePosition(afterOurs, root)) return child;
+
+        const MCTSNode& childNode = nodes[child];
+        for (int j = 0; j < childNode.childCount; j++) {
+            int32_t grandchild = childNode.firstChild + j;
+            GameState afterReply = afterOurs;
+            afterReply.play(nodes[grandchild].move);
+            if (samePosition(afterReply, root)) return grandchild;
+        }
+    }
+    return -1;
+}
+
+void MCTSPlayer::copySubtree(int32_t from) {
+    MCTSNodePool& target = reusePool;
+    target.clear();
+
+    // Breadth first so each node's children stay next to each other. Once
+    // the reuse pool is full the remaining nodes are left as leaves.
+    int32_t rootIndex = target.allocate(1);
+    target[rootIndex] = nodes[from];
+
+    copyQueue.clear();
+    copyQueue.emplace_back(from, rootIndex);
+    for (size_t next = 0; next < copyQueue.size(); next++) {
+        int32_t sourceIndex = copyQueue[next].first;
+        int32_t targetIndex = copyQueue[next].second;
+        const MCTSNode& node = nodes[sourceIndex];
+        if (node.firstChild < 0) continue;
+
+        int32_t first = target.allocate(node.childCount);
+        if (first < 0) {
+            target[targetIndex].firstChild = -1;
+            target[targetIndex].childCount = 0;
+            continue;
+        }
+        target[targetIndex].firstChild = first;
+        for (int i = 0; i < node.childCount; i++) {
+            target[first + i] = nodes[node.firstChild + i];
+            copyQueue.emplace_back(node.firstChild + i, first + i);
+        }
+    }
+
+    // Indices are the same at the front of the tree pool
+    size_t used = target.getUsed();
+    nodes.clear();
+    nodes.allocate(used);
+    std::copy(&target[0], &target[0] + used, &nodes[0]);
+}
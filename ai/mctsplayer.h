@@ -0,0 +1,217 @@
+#ifndef __MCTSPLAYER_H__
+#define __MCTSPLAYER_H__
+
+#include "../game/player.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AINetwork;
+class Board;
+class OpeningBook;
+
+// One position in the search tree. A node's children sit next to each
+// other in the pool, so a node only needs the index of the first one.
+//
+// In a parallel search the workers walk the tree without a lock, so the
+// fields they read while the evaluator writes them are atomic. The
+// evaluator fills in the children and childCount before it stores
+// firstChild (release), so a walker that sees firstChild sees them too.
+struct MCTSNode {
+    std::atomic<int32_t> firstChild;  // -1 until expanded
+    uint8_t childCount;
+    std::atomic<bool> terminal;       // no moves here, the side to move has lost
+    std::atomic<int16_t> virtualLoss; // playouts through here still waiting for a leaf value
+    Move move;                        // move that led to this node
+    float prior;
+    std::atomic<int32_t> visits;
+    std::atomic<float> valueSum;      // from the point of view of the player who made move
+
+    MCTSNode() : MCTSNode(Move{}, 0.0f) {}
+    MCTSNode(const Move& move, float prior)
+        : firstChild(-1), childCount(0), terminal(false), virtualLoss(0), move(move), prior(prior), visits(0), valueSum(0.0f) {}
+
+    // Only copied between searches, when no other thread is running
+    MCTSNode(const MCTSNode& other) : MCTSNode() { *this = other; }
+    MCTSNode& operator=(const MCTSNode& other) {
+        firstChild.store(other.firstChild.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        childCount = other.childCount;
+        terminal.store(other.terminal.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        virtualLoss.store(other.virtualLoss.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        move = other.move;
+        prior = other.prior;
+        visits.store(other.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        valueSum.store(other.valueSum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+};
+
+// Preallocated node storage. Nodes are handed out from the front and only
+// freed all at once, so a playout never touches the allocator.
+class MCTSNodePool {
+private:
+    std::vector<MCTSNode> nodes;
+    size_t used;
+
+public:
+    explicit MCTSNodePool(size_t capacity = 0) : nodes(capacity), used(0) {}
+
+    // Index of count consecutive nodes, -1 if the pool is full
+    int32_t allocate(int count) {
+        if (used + count > nodes.size()) return -1;
+        int32_t first = used;
+        used += count;
+        return first;
+    }
+
+    void clear() { used = 0; }
+    MCTSNode& operator[](int32_t index) { return nodes[index]; }
+    size_t getUsed() const { return used; }
+    size_t getCapacity() const { return nodes.size(); }
+};
+
+// What the last search did, for reporting and tools
+struct MCTSStats {
+    uint64_t playouts;
+    double seconds;
+    size_t nodesUsed;
+    size_t nodesReused;   // kept from the previous move's tree
+    size_t memoryBytes;   // tree and reuse pools
+    uint64_t batches;     // network batches, 0 for a single threaded search
+    uint64_t collisions;  // descents that ended on a leaf already queued
+    double fullAfter;     // seconds until the pool filled, 0 if it didn't
+    Move bestMove;
+    int bestVisits;
+    float bestValue;      // average value of bestMove for us, -1 to 1
+
+    double getPlayoutsPerSecond() const { return seconds > 0 ? playouts / seconds : 0.0; }
+    double getAverageBatch() const { return batches ? double(playouts) / batches : 0.0; }
+};
+
+// Monte Carlo tree search guided by the DQN: its Q-values give the move
+// priors (softmax over the legal moves) and, through the best of them,
+// the value of a new leaf. Children are picked with PUCT. Without a model
+// the priors are uniform and leaves are valued by Evaluation::evaluate.
+//
+// The tree lives in one node pool that gets nearly all the memory. When the
+// position we are asked about is in the last tree (usually after our move
+// and the reply), that subtree is copied into a small second pool and back
+// to the front of the first, and the search carries on from it. A subtree
+// too big for the second pool keeps its top levels.
+//
+// With more than one thread or a batch size above one, worker threads walk
+// the tree without a lock, adding a virtual loss to every node they pass so
+// the next walk is steered elsewhere, and queue the leaf they reach. The
+// searching thread takes the queue a batch at a time, evaluates it, then
+// expands the leaves and backs the values up. It is the only thread that
+// adds nodes, so the mutex only guards the queue.
+class MCTSPlayer : public Player {
+private:
+    // A leaf waiting for the evaluator
+    struct LeafRequest {
+        int32_t node;
+        GameState state;
+        std::vector<int32_t> path;  // root to node, for the backup
+        MoveList moves;
+        float priors[Constants::MAX_MOVES];
+        float value;
+    };
+
+    int moveTimeMs;
+    int maxPlayouts;
+    bool verbose;
+    int threads;
+    int batchSize;
+
+    std::unique_ptr<AINetwork> network;
+    std::shared_ptr<const OpeningBook> book;
+
+    MCTSNodePool nodes;
+    MCTSNodePool reusePool;  // only holds a subtree while reuseTree moves it
+    bool hasTree;
+    GameState rootState;  // position at node 0 of the active pool
+
+    std::vector<int32_t> path;                            // reused by every playout
+    std::vector<std::pair<int32_t, int32_t>> copyQueue;  // reused by reuseTree
+    std::vector<float> networkInput;                      // reused by every network call
+    std::vector<float> networkOutput;                     // reused by every network call
+    std::vector<int> pending;                             // leaves in the network batch
+
+    MCTSStats lastStats;
+
+    // Shared by the workers and the evaluator during a parallel search,
+    // queueMutex guards the queue and the waits on it
+    std::mutex queueMutex;
+    std::condition_variable batchReady;  // wakes the evaluator
+    std::condition_variable batchDone;   // wakes waiting workers
+    std::vector<LeafRequest> queued;     // filled by the workers
+    std::vector<LeafRequest> evaluating; // being evaluated, swapped with queued
+    int queuedCount;
+    int waitingWorkers;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> playoutCount;
+    std::atomic<uint64_t> batchCount;
+    std::atomic<uint64_t> collisionCount;
+    std::chrono::steady_clock::time_point searchStart;
+    double fullAfter;  // see MCTSStats
+
+    void playout();
+    void parallelSearch(std::chrono::steady_clock::time_point deadline);
+    void parallelWorker();
+    int32_t selectChild(int32_t parent);
+    float expand(int32_t nodeIndex, const GameState& state);
+    float evaluateLeaf(const GameState& state, MoveList& moves, float* priors);
+    // Move priors from the network's Q-values for side to move (input from
+    // AIPlayer::moverToVector), returns the leaf value for that side
+    float networkPriors(const float* qValues, int side, const MoveList& moves, float* priors);
+    void evaluateBatch(std::vector<LeafRequest>& requests, int count);
+    void attachChildren(int32_t nodeIndex, const MoveList& moves, const float* priors);
+    void backup(const std::vector<int32_t>& branch, float value, bool virtualLoss);
+    bool reuseTree(const GameState& root);
+    int32_t findDescendant(const GameState& root);
+    void copySubtree(int32_t from);
+
+public:
+    // 10M nodes: about two seconds of tree growth with a network (5M new
+    // nodes a second), half a second without one (20M a second)
+    static constexpr size_t DEFAULT_MEMORY_MB = 256;
+
+    MCTSPlayer(int index, char startingPiece, int moveTimeMs = 1000, size_t memoryMb = DEFAULT_MEMORY_MB);
+    ~MCTSPlayer();
+
+    Move chooseMove(Board* board, const MoveList& legalMoves) override;
+
+    // Runs playouts from root until the move time or playout limit is
+    // reached. root must have at least one legal move.
+    MCTSStats search(const GameState& root);
+
+    // Priors and values from a trained DQN model, one trained as player 0
+    // (ai_player_0_final.model); player 1's nodes are read turned round
+    void useNetwork(const std::string& modelFile);
+
+    // Opening book from bookgen, a root in the book is played without searching
+    void setOpeningBook(std::shared_ptr<const OpeningBook> openings) { book = std::move(openings); }
+
+    void setMoveTime(int ms) { moveTimeMs = ms; }
+    void setMaxPlayouts(int playouts) { maxPlayouts = playouts; }
+    void setThreads(int count);
+    // Leaves per network batch, clamped to 1-256
+    void setBatchSize(int size);
+    int getThreads() const { return threads; }
+    int getBatchSize() const { return batchSize; }
+    void setVerbose(bool value) { verbose = value; }
+    const MCTSStats& getLastStats() const { return lastStats; }
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "movepicker.h"
+#include "../game/bitboard.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    // Above any capture score
+    constexpr int DEN_ENTRY_SCORE = 1 << 20;
+
+    // History scores are halved once one gets past this
+    constexpr int HISTORY_LIMIT = 1 << 24;
+
+    int rowDistance(int from, int to) {
+        int rows = GameState::toRow(from) - GameState::toRow(to);
+        return rows < 0 ? -rows : rows;
+    }
+}
+
+void MoveHistory::clear() {
+    std::fill(&killers[0][0], &killers[0][0] + sizeof(killers) / sizeof(int), -1);
+    std::fill(&scores[0][0][0], &scores[0][0][0] + sizeof(scores) / sizeof(int), 0);
+}
+
+void MoveHistory::age() {
+    std::fill(&killers[0][0], &killers[0][0] + sizeof(killers) / sizeof(int), -1);
+    for (int* score = &scores[0][0][0]; score != &scores[0][0][0] + sizeof(scores) / sizeof(int); score++) {
+        *score /= 2;
+    }
+}
+
+void MoveHistory::addCutoff(const GameState& state, const Move& move, int depth, int ply) {
+    int action = move.getActionIndex();
+    if (killers[ply][0] != action) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = action;
+    }
+
+    int& score = scores[state.sideToMove][move.piece][move.to];
+    score += depth * depth;
+    if (score > HISTORY_LIMIT) {
+        for (int* other = &scores[0][0][0]; other != &scores[0][0][0] + sizeof(scores) / sizeof(int); other++) {
+            *other /= 2;
+        }
+    }
+}
+
+MovePicker::MovePicker(const GameState& state, const MoveHistory& history, int tableAction, int ply)
+    : state(state),
+      history(history),
+      tableAction(tableAction),
+      killers{history.killers[ply][0], history.killers[ply][1]},
+      stage(Stage::TableMove),
+      quietStart(0),
+      losingStart(0),
+      current(0),
+      killerIndex(0)
+{
+}
+
+bool MovePicker::next(Move& move) {
+    while (true) {
+        switch (stage) {
+        case Stage::TableMove:
+            stage = Stage::Generate;
+            if (tableAction >= 0) {
+                // Only play it if it is legal here, the table key or the
+                // previous iteration's line may belong to another position
+                Constants::MOVE_RESULT result = state.resolve(tableAction / Constants::NUM_DIRECTIONS,
+                                                              tableAction % Constants::NUM_DIRECTIONS, move);
+                if (result == Constants::MOVE_SUCCESS || result == Constants::MOVE_KILLED) {
+                    return true;
+                }
+            }
+            break;
+
+        case Stage::Generate:
+            generate();
+            stage = Stage::Captures;
+            current = 0;
+            break;
+
+        case Stage::Captures:
+            while (current < quietStart) {
+                pickBest(quietStart);
+                move = moves[current++];
+                if (move.getActionIndex() != tableAction) return true;
+            }
+            stage = Stage::Killers;
+            break;
+
+        case Stage::Killers:
+            // Only a quiet move here can be played, and it is handed out
+            // by moving it to the front of the quiets
+            while (killerIndex < 2) {
+                int action = killers[killerIndex++];
+                if (action < 0 || action == tableAction) continue;
+                for (int i = current; i < losingStart; i++) {
+                    if (moves[i].getActionIndex() == action) {
+                        std::swap(moves.moves[i], moves.moves[current]);
+                        std::swap(scores[i], scores[current]);
+                        move = moves[current++];
+                        return true;
+                    }
+                }
+            }
+            stage = Stage::Quiets;
+            break;
+
+        case Stage::Quiets:
+            while (current < losingStart) {
+                pickBest(losingStart);
+                move = moves[current++];
+                int action = move.getActionIndex();
+                if (action != tableAction && action != killers[0] && action != killers[1]) return true;
+            }
+            stage = Stage::LosingCaptures;
+            break;
+
+        case Stage::LosingCaptures:
+            while (current < moves.size()) {
+                pickBest(moves.size());
+                move = moves[current++];
+                if (move.getActionIndex() != tableAction) return true;
+            }
+            stage = Stage::Done;
+            break;
+
+        case Stage::Done:
+            return false;
+        }
+    }
+}
+
+void MovePicker::generate() {
+    MoveList all;
+    state.generateMoves(all);
+
+    int side = state.sideToMove;
+    uint64_t enemy = state.occupied[side ^ 1];
+    int den = Bitboard::lsb(state.denMask[side]);
+
+    // Three passes put each kind of move in its own range
+    moves.clear();
+    for (const Move& move : all) {
+        if (move.to == den) {
+            scores[moves.size()] = DEN_ENTRY_SCORE;
+            moves.add(move);
+        }
+        else if (enemy & GameState::bit(move.to)) {
+            int owner;
+            int victim = state.pieceAt(move.to, owner);
+            if (winsBattle(state, move, victim)) {
+                scores[moves.size()] = captureScore(move, victim);
+                moves.add(move);
+            }
+        }
+    }
+    quietStart = moves.size();
+
+    for (const Move& move : all) {
+        if (isQuiet(state, move)) {
+            // History first, then towards the den we attack before away from it
+            int advance = rowDistance(move.from, den) - rowDistance(move.to, den);
+            scores[moves.size()] = history.scores[side][move.piece][move.to] * 4 + advance;
+            moves.add(move);
+        }
+    }
+    losingStart = moves.size();
+
+    for (const Move& move : all) {
+        if (move.to != den && (enemy & GameState::bit(move.to))) {
+            int owner;
+            int victim = state.pieceAt(move.to, owner);
+            if (!winsBattle(state, move, victim)) {
+                scores[moves.size()] = captureScore(move, victim);
+                moves.add(move);
+            }
+        }
+    }
+}
+
+void MovePicker::pickBest(int end) {
+    int best = current;
+    for (int i = current + 1; i < end; i++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    std::rotate(moves.moves + current, moves.moves + best, moves.moves + best + 1);
+    std::rotate(scores + current, scores + best, scores + best + 1);
+}
+
+bool MovePicker::winsBattle(const GameState& state, const Move& move, int victim) {
+    int atkStrength = (state.isTrap(move.to) || state.isTrap(move.from)) ? 0 : move.piece + 1;
+    int defStrength = state.isTrap(move.to) ? 0 : victim + 1;
+    return Bitboard::BATTLE.attackerWins[atkStrength][defStrength];
+}
+
+int MovePicker::captureScore(const Move& move, int victim) {
+    return Evaluation::PIECE_VALUE[victim] * Constants::NUM_PIECES - move.piece;
+}
+
+bool MovePicker::isQuiet(const GameState& state, const Move& move) {
+    uint64_t toBit = GameState::bit(move.to);
+    return !((state.occupied[state.sideToMove ^ 1] | state.denMask[state.sideToMove]) & toBit);
+}
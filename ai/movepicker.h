@@ -0,0 +1,78 @@
+#ifndef __MOVEPICKER_H__
+#define __MOVEPICKER_H__
+
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+#include "evaluation.h"
+
+// Quiet moves that caused beta cutoffs, kept by each search thread to
+// order the moves of later nodes. Killers are per ply, history scores are
+// per side, piece and destination square.
+struct MoveHistory {
+    int killers[Evaluation::MAX_PLY][2];  // Move::getActionIndex, -1 if none
+    int scores[2][Constants::NUM_PIECES][Constants::NUM_SQUARES];
+
+    void clear();
+    // Halves the history scores, so older searches count for less
+    void age();
+    // move was quiet and failed high at depth, ply
+    void addCutoff(const GameState& state, const Move& move, int depth, int ply);
+};
+
+// Hands out a node's moves a stage at a time, best guesses first:
+//   1. the table move (hash or principal variation move), before any
+//      move generation, so a cutoff from it skips generating the rest
+//   2. den entries, then captures the attacker wins, most valuable victim
+//      first and least valuable attacker among equals
+//   3. the killer moves for this ply
+//   4. the other quiet moves by history score
+//   5. captures the attacker loses
+// Each move is handed out once.
+class MovePicker {
+private:
+    enum class Stage {
+        TableMove,
+        Generate,
+        Captures,
+        Killers,
+        Quiets,
+        LosingCaptures,
+        Done
+    };
+
+    const GameState& state;
+    const MoveHistory& history;
+    int tableAction;
+    int killers[2];
+    Stage stage;
+
+    // Generated moves as [captures][quiets][losing captures]
+    MoveList moves;
+    int scores[Constants::MAX_MOVES];
+    int quietStart;
+    int losingStart;
+    int current;
+    int killerIndex;
+
+    void generate();
+    // Moves the best scored move in [current, end) to current
+    void pickBest(int end);
+
+public:
+    // tableAction is a Move::getActionIndex to try first, -1 for none
+    MovePicker(const GameState& state, const MoveHistory& history, int tableAction, int ply);
+
+    // False once every legal move has been handed out
+    bool next(Move& move);
+
+    // Whether the mover's piece survives capturing victim, under the same
+    // trap rules as GameState::play (MovementSystem::battle's strengths)
+    static bool winsBattle(const GameState& state, const Move& move, int victim);
+    // Most valuable victim, then least valuable attacker
+    static int captureScore(const Move& move, int victim);
+    // Neither a capture nor a den entry
+    static bool isQuiet(const GameState& state, const Move& move);
+};
+
+#endif
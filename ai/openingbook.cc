@@ -0,0 +1,109 @@
+#include "openingbook.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char MAGIC[4] = {'A', 'C', 'O', 'B'};
+    constexpr uint32_t VERSION = 1;
+}
+
+OpeningBook::OpeningBook()
+    : entries(nullptr), entryCount(0), minGames(1), trapMask(0), waterMask(0), denMask{0, 0}
+{
+}
+
+bool OpeningBook::open(const std::string& filename) {
+    close();
+
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(file.getData());
+    if (file.getSize() < sizeof(FileHeader) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION ||
+        sizeof(FileHeader) + header->entryCount * sizeof(BookEntry) > file.getSize()) {
+        std::cerr << "Error: " << filename << " is not an opening book" << std::endl;
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const BookEntry*>(file.getData() + sizeof(FileHeader));
+    entryCount = header->entryCount;
+    trapMask = header->trapMask;
+    waterMask = header->waterMask;
+    denMask[0] = header->denMask[0];
+    denMask[1] = header->denMask[1];
+    return true;
+}
+
+void OpeningBook::close() {
+    file.close();
+    entries = nullptr;
+    entryCount = 0;
+}
+
+const BookEntry* OpeningBook::find(uint64_t key, size_t& count) const {
+    count = 0;
+    if (!isOpen()) return nullptr;
+
+    const BookEntry* end = entries + entryCount;
+    const BookEntry* first = std::lower_bound(entries, end, key,
+        [](const BookEntry& entry, uint64_t k) { return entry.key < k; });
+
+    const BookEntry* last = first;
+    while (last != end && last->key == key) {
+        last++;
+    }
+    count = last - first;
+    return first;
+}
+
+bool OpeningBook::probe(const GameState& state, Move& move, BookEntry& stats) const {
+    if (!isOpen() || state.isGameOver()) return false;
+
+    if (state.trapMask != trapMask || state.waterMask != waterMask ||
+        state.denMask[0] != denMask[0] || state.denMask[1] != denMask[1]) {
+        return false;
+    }
+
+    size_t count;
+    const BookEntry* found = find(state.hash, count);
+    if (count == 0) return false;
+
+    MoveList moves;
+    state.generateMoves(moves);
+
+    bool inBook = false;
+    for (size_t i = 0; i < count; i++) {
+        const BookEntry& entry = found[i];
+        if (entry.games < static_cast<uint32_t>(minGames)) continue;
+
+        // A different position with the same key could suggest anything
+        for (const Move& legal : moves) {
+            if (legal.getActionIndex() != entry.action) continue;
+
+            if (!inBook || entry.getScore() > stats.getScore() ||
+                (entry.getScore() == stats.getScore() && entry.games > stats.games)) {
+                move = legal;
+                stats = entry;
+                inBook = true;
+            }
+        }
+    }
+    return inBook;
+}
+
+OpeningBook::FileHeader OpeningBook::makeHeader(const GameState& layout, uint64_t entryCount) {
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = entryCount;
+    header.trapMask = layout.trapMask;
+    header.waterMask = layout.waterMask;
+    header.denMask[0] = layout.denMask[0];
+    header.denMask[1] = layout.denMask[1];
+    return header;
+}
@@ -0,0 +1,74 @@
+#ifndef __OPENINGBOOK_H__
+#define __OPENINGBOOK_H__
+
+#include "mappedfile.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// How one move from one position did in the recorded games, for the
+// player who made it
+struct BookEntry {
+    uint64_t key;     // Zobrist hash of the position
+    uint32_t games;
+    uint32_t wins;
+    uint32_t draws;
+    uint8_t action;   // Move::getActionIndex
+    uint8_t padding[3];
+
+    double getScore() const { return games ? (wins + 0.5 * draws) / games : 0.0; }
+};
+
+// Opening moves learned from self-play, written by tools/bookgen and read
+// through mmap. Entries are sorted by key and then action, so a lookup is
+// a binary search over the mapped file.
+class OpeningBook {
+public:
+    // File layout: header, then the entries
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t entryCount;
+        uint64_t trapMask;
+        uint64_t waterMask;
+        uint64_t denMask[2];
+    };
+
+private:
+    MappedFile file;
+    const BookEntry* entries;
+    size_t entryCount;
+    int minGames;
+
+    // Board the games were played on
+    uint64_t trapMask;
+    uint64_t waterMask;
+    uint64_t denMask[2];
+
+public:
+    OpeningBook();
+
+    // Maps a file written by bookgen, false (with a message) if it can't be used
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return entries != nullptr; }
+    size_t size() const { return entryCount; }
+
+    // Moves played fewer times than this are ignored by probe
+    void setMinGames(int games) { minGames = games; }
+
+    // Entries for key, count is 0 if the position is not in the book
+    const BookEntry* find(uint64_t key, size_t& count) const;
+
+    // The legal book move with the best score in state, ties going to the
+    // one played most. False when out of book.
+    bool probe(const GameState& state, Move& move, BookEntry& stats) const;
+
+    static FileHeader makeHeader(const GameState& layout, uint64_t entryCount);
+};
+
+#endif
@@ -0,0 +1,415 @@
+#include "quantizednetwork.h"
+#include "ainetwork.h"
+#include "gemv.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace {
+    // Model files start with this
+    constexpr char MAGIC[4] = {'A', 'C', 'Q', '8'};
+    constexpr uint32_t VERSION = 1;
+
+    // Weight rows are padded to whole cache lines, so every kernel runs
+    // whole vectors with no tail
+    constexpr int ROW_ALIGNMENT = 64;
+    constexpr int WEIGHT_MAX = 127;
+
+    // Kernels write the int32 dot product of each of outputs weight rows
+    // with input, over the whole padded row
+    using Kernel = void (*)(const int8_t* weights, int stride, const uint8_t* input, int outputs, int32_t* sums);
+
+    int roundToRow(int bytes) {
+        return (bytes + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+    }
+
+    // The steps around the kernels go four values at a time in SSE2, which
+    // every x86-64 CPU has, and give the same results as the scalar tails
+
+    // values to 0-127, rounding half up
+    void quantizeInputs(const float* values, int count, float inverseScale, int zeroPoint, uint8_t* out) {
+        const float zero = zeroPoint + 0.5f;
+        const float top = QuantizedNetwork::INPUT_MAX;
+        int j = 0;
+        for (; j + 4 <= count; j += 4) {
+            __m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + j), _mm_set1_ps(inverseScale)), _mm_set1_ps(zero));
+            scaled = _mm_min_ps(_mm_max_ps(scaled, _mm_setzero_ps()), _mm_set1_ps(top));
+            __m128i words = _mm_packs_epi32(_mm_cvttps_epi32(scaled), _mm_setzero_si128());
+            int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+            std::memcpy(out + j, &bytes, sizeof(bytes));
+        }
+        for (; j < count; ++j) {
+            float scaled = values[j] * inverseScale + zero;
+            out[j] = static_cast<uint8_t>(std::min(std::max(scaled, 0.0f), top));
+        }
+    }
+
+    // Kernel sums back to float: (sum - offset) * scale + bias, with ReLU
+    void dequantize(const int32_t* sums, const int32_t* offsets, const float* scales, const float* biases,
+                    int count, float* out, bool relu) {
+        const float floor = relu ? 0.0f : -std::numeric_limits<float>::infinity();
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i sum = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + i)));
+            __m128 value = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_loadu_ps(scales + i)), _mm_loadu_ps(biases + i));
+            _mm_storeu_ps(out + i, _mm_max_ps(value, _mm_set1_ps(floor)));
+        }
+        for (; i < count; ++i) {
+            float value = (sums[i] - offsets[i]) * scales[i] + biases[i];
+            out[i] = std::max(value, floor);
+        }
+    }
+
+    int32_t scalarRow(const int8_t* row, const uint8_t* input, int length) {
+        int32_t sum = 0;
+        for (int j = 0; j < length; ++j) {
+            sum += static_cast<int32_t>(row[j]) * input[j];
+        }
+        return sum;
+    }
+
+    void dotScalar(const int8_t* weights, int stride, const uint8_t* input, int outputs, int32_t* sums) {
+        for (int i = 0; i < outputs; ++i) {
+            sums[i] = scalarRow(weights + static_cast<size_t>(i) * stride, input, stride);
+        }
+    }
+
+    // pmaddubsw multiplies unsigned input bytes by signed weight bytes and
+    // adds neighbouring pairs into 16 bits (at most 2 * 127 * 127, so no
+    // saturation), pmaddwd then adds pairs of those into 32 bits
+    __attribute__((target("ssse3")))
+    inline __m128i dotStepSSSE3(__m128i input, const int8_t* row, __m128i sum) {
+        __m128i pairs = _mm_maddubs_epi16(input, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row)));
+        return _mm_add_epi32(sum, _mm_madd_epi16(pairs, _mm_set1_epi16(1)));
+    }
+
+    __attribute__((target("ssse3")))
+    void dotSSSE3(const int8_t* weights, int stride, const uint8_t* input, int outputs, int32_t* sums) {
+        int i = 0;
+        for (; i + 4 <= outputs; i += 4) {
+            const int8_t* row = weights + static_cast<size_t>(i) * stride;
+            __m128i acc0 = _mm_setzero_si128();
+            __m128i acc1 = _mm_setzero_si128();
+            __m128i acc2 = _mm_setzero_si128();
+            __m128i acc3 = _mm_setzero_si128();
+            for (int j = 0; j < stride; j += 16) {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + j));
+                acc0 = dotStepSSSE3(x, row + j, acc0);
+                acc1 = dotStepSSSE3(x, row + stride + j, acc1);
+                acc2 = dotStepSSSE3(x, row + 2 * stride + j, acc2);
+                acc3 = dotStepSSSE3(x, row + 3 * stride + j, acc3);
+            }
+            __m128i total = _mm_hadd_epi32(_mm_hadd_epi32(acc0, acc1), _mm_hadd_epi32(acc2, acc3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), total);
+        }
+        for (; i < outputs; ++i) {
+            sums[i] = scalarRow(weights + static_cast<size_t>(i) * stride, input, stride);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i dotStepAVX2(__m256i input, const int8_t* row, __m256i sum) {
+        __m256i pairs = _mm256_maddubs_epi16(input, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row)));
+        return _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+    }
+
+    // Lane k of the result is row k's total
+    __attribute__((target("avx2")))
+    inline __m128i sum4(__m256i row0, __m256i row1, __m256i row2, __m256i row3) {
+        __m256i sums = _mm256_hadd_epi32(_mm256_hadd_epi32(row0, row1), _mm256_hadd_epi32(row2, row3));
+        return _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    }
+
+    __attribute__((target("avx2")))
+    void dotAVX2(const int8_t* weights, int stride, const uint8_t* input, int outputs, int32_t* sums) {
+        int i = 0;
+        for (; i + 4 <= outputs; i += 4) {
+            const int8_t* row = weights + static_cast<size_t>(i) * stride;
+            __m256i acc0 = _mm256_setzero_si256();
+            __m256i acc1 = _mm256_setzero_si256();
+            __m256i acc2 = _mm256_setzero_si256();
+            __m256i acc3 = _mm256_setzero_si256();
+            for (int j = 0; j < stride; j += 32) {
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + j));
+                acc0 = dotStepAVX2(x, row + j, acc0);
+                acc1 = dotStepAVX2(x, row + stride + j, acc1);
+                acc2 = dotStepAVX2(x, row + 2 * stride + j, acc2);
+                acc3 = dotStepAVX2(x, row + 3 * stride + j, acc3);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), sum4(acc0, acc1, acc2, acc3));
+        }
+        for (; i < outputs; ++i) {
+            sums[i] = scalarRow(weights + static_cast<size_t>(i) * stride, input, stride);
+        }
+    }
+
+    // vpdpbusd does the multiply and both adds in one instruction, straight
+    // into 32 bits
+    __attribute__((target("avx512f,avx512bw,avx512vnni")))
+    void dotVNNI(const int8_t* weights, int stride, const uint8_t* input, int outputs, int32_t* sums) {
+        int i = 0;
+        for (; i + 4 <= outputs; i += 4) {
+            const int8_t* row = weights + static_cast<size_t>(i) * stride;
+            __m512i acc0 = _mm512_setzero_si512();
+            __m512i acc1 = _mm512_setzero_si512();
+            __m512i acc2 = _mm512_setzero_si512();
+            __m512i acc3 = _mm512_setzero_si512();
+            for (int j = 0; j < stride; j += 64) {
+                __m512i x = _mm512_loadu_si512(input + j);
+                acc0 = _mm512_dpbusd_epi32(acc0, x, _mm512_loadu_si512(row + j));
+                acc1 = _mm512_dpbusd_epi32(acc1, x, _mm512_loadu_si512(row + stride + j));
+                acc2 = _mm512_dpbusd_epi32(acc2, x, _mm512_loadu_si512(row + 2 * stride + j));
+                acc3 = _mm512_dpbusd_epi32(acc3, x, _mm512_loadu_si512(row + 3 * stride + j));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), sum4(Simd::fold(acc0), Simd::fold(acc1), Simd::fold(acc2), Simd::fold(acc3)));
+        }
+        for (; i < outputs; ++i) {
+            sums[i] = scalarRow(weights + static_cast<size_t>(i) * stride, input, stride);
+        }
+    }
+
+    struct KernelChoice {
+        Kernel kernel;
+        const char* name;
+    };
+
+    // Widest kernel the CPU can run, worked out once
+    const KernelChoice& bestKernel() {
+        static const KernelChoice choice = [] {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) {
+                return KernelChoice{dotVNNI, "avx512-vnni"};
+            }
+            if (__builtin_cpu_supports("avx2")) return KernelChoice{dotAVX2, "avx2"};
+            if (__builtin_cpu_supports("ssse3")) return KernelChoice{dotSSSE3, "ssse3"};
+            return KernelChoice{dotScalar, "scalar"};
+        }();
+        return choice;
+    }
+}
+
+constexpr int QuantizedNetwork::INPUT_MAX;
+
+void QuantizedNetwork::quantize(const AINetwork& network, const std::vector<float>& samples, int count) {
+    const std::vector<NetworkLayer>& source = network.getLayers();
+    layerSizes = {source.front().inputs};
+    for (const NetworkLayer& layer : source) {
+        layerSizes.push_back(layer.outputs);
+    }
+
+    // Range of each layer's float input over the samples
+    std::vector<float> lowest(source.size(), 0.0f);
+    std::vector<float> highest(source.size(), 0.0f);
+    size_t widest = *std::max_element(layerSizes.begin(), layerSizes.end());
+    std::vector<float> current(widest);
+    std::vector<float> next(widest);
+    for (int s = 0; s < count; ++s) {
+        const float* sample = samples.data() + static_cast<size_t>(s) * getInputSize();
+        std::copy(sample, sample + getInputSize(), current.begin());
+        for (size_t l = 0; l < source.size(); ++l) {
+            auto range = std::minmax_element(current.begin(), current.begin() + source[l].inputs);
+            lowest[l] = std::min(lowest[l], *range.first);
+            highest[l] = std::max(highest[l], *range.second);
+            Gemv::forward(source[l], current.data(), next.data(), l + 1 < source.size());
+            std::swap(current, next);
+        }
+    }
+
+    layers.clear();
+    layers.resize(source.size());
+    for (size_t l = 0; l < source.size(); ++l) {
+        const NetworkLayer& from = source[l];
+        Layer& layer = layers[l];
+        layer.inputs = from.inputs;
+        layer.outputs = from.outputs;
+        layer.stride = roundToRow(from.inputs);
+
+        // Zero must be exact, then the scale is stretched until both ends
+        // of the range fit after the zero point is rounded
+        float low = lowest[l];
+        float high = std::max(highest[l], low + 1e-6f);
+        layer.inputScale = (high - low) / INPUT_MAX;
+        layer.inputZero = std::min(INPUT_MAX, static_cast<int>(std::lrint(-low / layer.inputScale)));
+        if (layer.inputZero > 0) {
+            layer.inputScale = std::max(layer.inputScale, -low / layer.inputZero);
+        }
+        if (layer.inputZero < INPUT_MAX) {
+            layer.inputScale = std::max(layer.inputScale, high / (INPUT_MAX - layer.inputZero));
+        }
+
+        layer.weights.assign(static_cast<size_t>(layer.outputs) * layer.stride, 0);
+        layer.weightScales.resize(layer.outputs);
+        layer.biases.assign(from.biases(), from.biases() + from.outputs);
+        for (int i = 0; i < layer.outputs; ++i) {
+            const float* row = from.row(i);
+            float largest = 0.0f;
+            for (int j = 0; j < layer.inputs; ++j) {
+                largest = std::max(largest, std::fabs(row[j]));
+            }
+            float scale = largest > 0.0f ? largest / WEIGHT_MAX : 1.0f;
+            layer.weightScales[i] = scale;
+
+            int8_t* quantized = &layer.weights[static_cast<size_t>(i) * layer.stride];
+            for (int j = 0; j < layer.inputs; ++j) {
+                int value = static_cast<int>(std::lrint(row[j] / scale));
+                quantized[j] = static_cast<int8_t>(std::min(std::max(value, -WEIGHT_MAX), WEIGHT_MAX));
+            }
+        }
+        finishLayer(layer);
+    }
+}
+
+void QuantizedNetwork::finishLayer(Layer& layer) {
+    layer.inverseScale = 1.0f / layer.inputScale;
+    layer.zeroOffsets.resize(layer.outputs);
+    layer.outputScales.resize(layer.outputs);
+    for (int i = 0; i < layer.outputs; ++i) {
+        const int8_t* row = &layer.weights[static_cast<size_t>(i) * layer.stride];
+        layer.zeroOffsets[i] = layer.inputZero * std::accumulate(row, row + layer.inputs, 0);
+        layer.outputScales[i] = layer.weightScales[i] * layer.inputScale;
+    }
+}
+
+size_t QuantizedNetwork::widestStride() const {
+    size_t widest = 0;
+    for (const Layer& layer : layers) {
+        widest = std::max({widest, static_cast<size_t>(layer.stride), static_cast<size_t>(roundToRow(layer.outputs))});
+    }
+    return widest;
+}
+
+void QuantizedNetwork::predict(const float* input, float* output) const {
+    thread_local std::vector<uint8_t> activations;
+    thread_local std::vector<int32_t> sums;
+    thread_local std::vector<float> values;
+    size_t widest = widestStride();
+    if (activations.size() < widest) {
+        activations.assign(widest, 0);
+        sums.assign(widest, 0);
+        values.assign(widest, 0.0f);
+    }
+
+    const Layer& first = layers.front();
+    quantizeInputs(input, first.inputs, first.inverseScale, first.inputZero, activations.data());
+
+    Kernel kernel = bestKernel().kernel;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        const Layer& layer = layers[l];
+        kernel(layer.weights.data(), layer.stride, activations.data(), layer.outputs, sums.data());
+
+        // Q-values from the last layer, otherwise ReLU and the next
+        // layer's input
+        if (l + 1 == layers.size()) {
+            dequantize(sums.data(), layer.zeroOffsets.data(), layer.outputScales.data(), layer.biases.data(),
+                       layer.outputs, output, false);
+            break;
+        }
+        const Layer& next = layers[l + 1];
+        dequantize(sums.data(), layer.zeroOffsets.data(), layer.outputScales.data(), layer.biases.data(),
+                   layer.outputs, values.data(), true);
+        quantizeInputs(values.data(), layer.outputs, next.inverseScale, next.inputZero, activations.data());
+    }
+}
+
+bool QuantizedNetwork::saveToFile(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: Could not save quantized network to " << filename << std::endl;
+        return false;
+    }
+
+    // Header: magic, version and layer sizes, then per layer the input
+    // quantization, the row scales, the biases and the unpadded weight rows
+    file.write(MAGIC, sizeof(MAGIC));
+    file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    uint64_t numLayers = layerSizes.size();
+    file.write(reinterpret_cast<const char*>(&numLayers), sizeof(numLayers));
+    file.write(reinterpret_cast<const char*>(layerSizes.data()), numLayers * sizeof(int));
+
+    for (const Layer& layer : layers) {
+        int32_t zero = layer.inputZero;
+        file.write(reinterpret_cast<const char*>(&layer.inputScale), sizeof(layer.inputScale));
+        file.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+        file.write(reinterpret_cast<const char*>(layer.weightScales.data()), layer.outputs * sizeof(float));
+        file.write(reinterpret_cast<const char*>(layer.biases.data()), layer.outputs * sizeof(float));
+        for (int i = 0; i < layer.outputs; ++i) {
+            file.write(reinterpret_cast<const char*>(&layer.weights[static_cast<size_t>(i) * layer.stride]), layer.inputs);
+        }
+    }
+
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Could not save quantized network to " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool QuantizedNetwork::loadFromFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Could not read or open file: " << filename << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(MAGIC)] = {};
+    uint32_t version = 0;
+    uint64_t numLayers = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&numLayers), sizeof(numLayers));
+    bool loaded = file && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 && version == VERSION &&
+                  numLayers >= 2 && numLayers <= 64;
+
+    std::vector<int> sizes(loaded ? numLayers : 0);
+    file.read(reinterpret_cast<char*>(sizes.data()), sizes.size() * sizeof(int));
+
+    std::vector<Layer> fileLayers(loaded ? numLayers - 1 : 0);
+    for (size_t l = 0; loaded && l < fileLayers.size(); ++l) {
+        Layer& layer = fileLayers[l];
+        if (sizes[l] <= 0 || sizes[l + 1] <= 0) {
+            loaded = false;
+            break;
+        }
+        layer.inputs = sizes[l];
+        layer.outputs = sizes[l + 1];
+        layer.stride = roundToRow(layer.inputs);
+
+        int32_t zero = 0;
+        file.read(reinterpret_cast<char*>(&layer.inputScale), sizeof(layer.inputScale));
+        file.read(reinterpret_cast<char*>(&zero), sizeof(zero));
+        layer.inputZero = zero;
+        layer.weightScales.resize(layer.outputs);
+        layer.biases.resize(layer.outputs);
+        file.read(reinterpret_cast<char*>(layer.weightScales.data()), layer.outputs * sizeof(float));
+        file.read(reinterpret_cast<char*>(layer.biases.data()), layer.outputs * sizeof(float));
+        layer.weights.assign(static_cast<size_t>(layer.outputs) * layer.stride, 0);
+        for (int i = 0; i < layer.outputs; ++i) {
+            file.read(reinterpret_cast<char*>(&layer.weights[static_cast<size_t>(i) * layer.stride]), layer.inputs);
+        }
+        loaded = file && layer.inputScale > 0.0f && zero >= 0 && zero <= INPUT_MAX;
+        if (loaded) {
+            finishLayer(layer);
+        }
+    }
+
+    if (!loaded) {
+        std::cerr << "Error: " << filename << " is not a quantized network" << std::endl;
+        return false;
+    }
+    layerSizes = std::move(sizes);
+    layers = std::move(fileLayers);
+    return true;
+}
+
+const char* QuantizedNetwork::getKernelName() {
+    return bestKernel().name;
+}
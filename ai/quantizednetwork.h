@@ -0,0 +1,67 @@
+#ifndef __QUANTIZEDNETWORK_H__
+#define __QUANTIZEDNETWORK_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AINetwork;
+
+// Int8 copy of a trained AINetwork for play. Each weight row (output
+// neuron) has its own scale, each layer's input is quantized to 0-127 with
+// a scale and zero point found by running the float network over sample
+// positions, and products are summed in int32. The sums are scaled back
+// to float per neuron, where the bias and ReLU are applied before the
+// next layer's input is quantized.
+//
+// Inputs stop at 127 so the pmaddubsw kernels can't saturate their 16 bit
+// pair sums; with that, every kernel (scalar, SSSE3, AVX2, AVX-512 VNNI)
+// gives the same sums, and the same output on any CPU.
+class QuantizedNetwork {
+private:
+    struct Layer {
+        int inputs;
+        int outputs;
+        int stride;                       // bytes from one weight row to the next
+        std::vector<int8_t> weights;      // rows padded with zeros to stride
+        std::vector<float> weightScales;  // per row
+        std::vector<float> biases;
+        std::vector<int32_t> zeroOffsets; // per row, inputZero * the row's sum
+        std::vector<float> outputScales;  // weightScales * inputScale
+        float inputScale;
+        float inverseScale;
+        int inputZero;
+    };
+
+    std::vector<Layer> layers;
+    std::vector<int> layerSizes;
+
+    void finishLayer(Layer& layer);
+    size_t widestStride() const;
+
+public:
+    static constexpr int INPUT_MAX = 127;
+
+    QuantizedNetwork() = default;
+
+    // Quantizes network, with the input ranges taken from count sample
+    // inputs stored one after another
+    void quantize(const AINetwork& network, const std::vector<float>& samples, int count);
+
+    // Forward pass from getInputSize() floats into getOutputSize() floats,
+    // in per-thread scratch
+    void predict(const float* input, float* output) const;
+
+    // Own file format, not readable as an AINetwork model
+    bool saveToFile(const std::string& filename) const;
+    bool loadFromFile(const std::string& filename);
+
+    bool empty() const { return layers.empty(); }
+    int getInputSize() const { return layerSizes.front(); }
+    int getOutputSize() const { return layerSizes.back(); }
+
+    // Instruction set of the kernel in use
+    static const char* getKernelName();
+};
+
+#endif
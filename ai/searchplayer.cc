@@ -0,0 +1,658 @@
+#include "searchplayer.h"
+#include "aiplayer.h"
+#include "ainetwork.h"
+#include "evaluation.h"
+#include "movepicker.h"
+#include "openingbook.h"
+#include "tablebase.h"
+#include "../game/bitboard.h"
+#include "../game/board.h"
+#include "../game/gamestate.h"
+#include "../game/zobrist.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace {
+    // Check the clock once every this many nodes
+    constexpr uint64_t TIME_CHECK_INTERVAL = 2048;
+
+    // DQN Q-values are rewards (a win is worth 200), scaled to eval units
+    constexpr float NETWORK_SCALE = 10.0f;
+
+    // Quiescence skips a capture that can't bring the score back up to
+    // alpha even with this much positional gain on top of the material
+    constexpr int DELTA_MARGIN = 200;
+
+    // Win scores count plies from the root, the table stores them counted
+    // from the node so they stay right wherever the position turns up
+    int scoreToTable(int score, int ply) {
+        if (score >= Evaluation::WIN_BOUND) return score + ply;
+        if (score <= -Evaluation::WIN_BOUND) return score - ply;
+        return score;
+    }
+
+    int scoreFromTable(int score, int ply) {
+        if (score >= Evaluation::WIN_BOUND) return score - ply;
+        if (score <= -Evaluation::WIN_BOUND) return score + ply;
+        return score;
+    }
+
+    // Tablebase results as search scores. A win too far away to count in
+    // plies still beats any evaluation.
+    int tablebaseScore(const TBResult& result, int ply) {
+        if (result.wdl == WDL::Draw) return 0;
+
+        int score = std::max(Evaluation::WIN_SCORE - ply - result.dtm, Evaluation::WIN_BOUND - 1);
+        return result.wdl == WDL::Win ? score : -score;
+    }
+
+    // Highest score first. Insertion sort, there are at most 32 moves.
+    void sortMoves(MoveList& moves, int* scores) {
+        for (int i = 1; i < moves.size(); i++) {
+            Move move = moves[i];
+            int score = scores[i];
+            int j = i - 1;
+            while (j >= 0 && scores[j] < score) {
+                moves.moves[j + 1] = moves.moves[j];
+                scores[j + 1] = scores[j];
+                j--;
+            }
+            moves.moves[j + 1] = move;
+            scores[j + 1] = score;
+        }
+    }
+}
+
+SearchPlayer::SearchPlayer(int index, char startingPiece, int maxDepth, int moveTimeMs, size_t hashMb, int threads)
+    : Player(index, startingPiece),
+      maxDepth(std::min(maxDepth, Evaluation::MAX_PLY - 1)),
+      verbose(true),
+      ponder(false),
+      timeControl(moveTimeMs),
+      stopped(false),
+      lastResult{},
+      lastTableStats{},
+      pondering(false),
+      ponderRoot{},
+      ponderResult{},
+      hasExpectedReply(false),
+      expectedReply{},
+      ponderHits(0),
+      ponderMisses(0)
+{
+    table = std::make_unique<TranspositionTable>(hashMb);
+    setThreads(threads);
+}
+
+SearchPlayer::~SearchPlayer() {
+    stopPondering();
+}
+
+void SearchPlayer::setThreads(int threads) {
+    workers.clear();
+    for (int i = 0; i < std::max(threads, 1); i++) {
+        workers.push_back(std::make_unique<SearchWorker>());
+        workers.back()->id = i;
+        workers.back()->history.clear();
+    }
+}
+
+void SearchPlayer::useNetwork(const std::string& modelFile) {
+    network = std::make_unique<AINetwork>(AIPlayer::getNetworkLayers());
+    network->loadFromFile(modelFile);
+}
+
+Move SearchPlayer::chooseMove(Board* board, const MoveList& legalMoves) {
+    GameState root = board->saveState();
+    if (root.sideToMove != getIndex()) {
+        root.sideToMove = getIndex();
+        root.hash = Zobrist::hash(root);
+    }
+
+    SearchResult result;
+    bool pondered = finishPondering(root, result);
+    hasExpectedReply = false;
+
+    // Nothing to search when the book or the tables know the answer
+    Move bookMove;
+    BookEntry bookStats;
+    if (book && book->probe(root, bookMove, bookStats)) {
+        if (verbose) {
+            std::cout << "book " << bookMove.getPieceId() << bookMove.getDirection() << " played " << bookStats.games
+                      << " times, scoring " << bookStats.getScore() * 100 << "%" << std::endl;
+        }
+        for (const Move& move : legalMoves) {
+            if (move == bookMove) {
+                return move;
+            }
+        }
+    }
+
+    Move tableMove;
+    TBResult tableResult;
+    if (tablebase && tablebase->bestMove(root, tableMove, tableResult)) {
+        if (verbose) {
+            const char* outcome = tableResult.wdl == WDL::Win ? "win" : (tableResult.wdl == WDL::Loss ? "loss" : "draw");
+            std::cout << "tablebase " << outcome << " in " << tableResult.dtm << " plies" << std::endl;
+        }
+        for (const Move& move : legalMoves) {
+            if (move == tableMove) {
+                return move;
+            }
+        }
+    }
+
+    if (!pondered) {
+        result = search(root);
+    }
+    if (verbose && timeControl.usesClock()) {
+        std::cout << "clock " << timeControl.getClockMs() / 1000.0 << "s left" << std::endl;
+    }
+    hasExpectedReply = result.hasExpectedReply;
+    expectedReply = result.expectedReply;
+
+    // The search plays from the same generator, but never hand back
+    // something the controller did not offer
+    for (const Move& move : legalMoves) {
+        if (move == result.bestMove) {
+            return move;
+        }
+    }
+    return legalMoves[0];
+}
+
+void SearchPlayer::startPondering(Board* board) {
+    stopPondering();
+    if (!ponder || !hasExpectedReply) return;
+
+    GameState state = board->saveState();
+    state.sideToMove = getIndex() ^ 1;
+    state.hash = Zobrist::hash(state);
+
+    Move reply;
+    Constants::MOVE_RESULT moveResult = state.resolve(expectedReply.piece, expectedReply.dir, reply);
+    if (moveResult != Constants::MOVE_SUCCESS && moveResult != Constants::MOVE_KILLED) return;
+    state.play(reply);
+
+    MoveList moves;
+    state.generateMoves(moves);
+    if (state.isGameOver() || moves.empty()) return;
+
+    // No limits until the reply is played, the opponent's time is free
+    ponderRoot = state;
+    timeControl.startInfinite();
+    startSearch();
+    pondering = true;
+    ponderThread = std::thread([this] { ponderResult = runSearch(ponderRoot); });
+}
+
+void SearchPlayer::stopPondering() {
+    if (!ponderThread.joinable()) return;
+
+    stopped = true;
+    ponderThread.join();
+    pondering = false;
+}
+
+bool SearchPlayer::finishPondering(const GameState& root, SearchResult& result) {
+    if (!ponderThread.joinable()) return false;
+
+    if (root.hash != ponderRoot.hash || root.occupied[0] != ponderRoot.occupied[0] ||
+        root.occupied[1] != ponderRoot.occupied[1]) {
+        ponderMisses++;
+        stopPondering();
+        return false;
+    }
+
+    // The expected reply was played: the ponder search goes on with this
+    // move's time, then stops like any other
+    ponderHits++;
+    timeControl.startMove();
+    if (verbose) {
+        std::cout << "ponder hit" << std::endl;
+    }
+    pondering = false;
+    ponderThread.join();
+    timeControl.finishMove();
+
+    result = ponderResult;
+    return true;
+}
+
+SearchResult SearchPlayer::search(const GameState& root) {
+    timeControl.startMove();
+    startSearch();
+    SearchResult result = runSearch(root);
+    timeControl.finishMove();
+    return result;
+}
+
+void SearchPlayer::startSearch() {
+    startTime = std::chrono::steady_clock::now();
+    stopped = false;
+    table->newSearch();
+}
+
+SearchResult SearchPlayer::runSearch(const GameState& root) {
+    // Helpers first, the main thread searches on this one
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < workers.size(); i++) {
+        helpers.emplace_back(&SearchPlayer::iterativeDeepening, this, std::ref(*workers[i]), std::cref(root));
+    }
+
+    SearchWorker& main = *workers[0];
+    iterativeDeepening(main, root);
+
+    stopped = true;
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    SearchResult result = main.result;
+    lastTableStats = TTStats{};
+    result.nodes = 0;
+    result.tablebaseHits = 0;
+    result.quiescenceNodes = 0;
+    result.deltaPrunes = 0;
+    result.betaCutoffs = 0;
+    result.firstMoveCutoffs = 0;
+    for (const auto& worker : workers) {
+        result.nodes += worker->nodes;
+        result.tablebaseHits += worker->tablebaseHits;
+        result.quiescenceNodes += worker->quiescenceNodes;
+        result.deltaPrunes += worker->deltaPrunes;
+        result.betaCutoffs += worker->betaCutoffs;
+        result.firstMoveCutoffs += worker->firstMoveCutoffs;
+        lastTableStats += worker->tableStats;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    findExpectedReply(main, root, result);
+    lastResult = result;
+
+    if (verbose && !pondering) {
+        std::cout << "threads " << workers.size() << " nodes " << result.nodes
+                  << " nps " << static_cast<uint64_t>(result.getNodesPerSecond())
+                  << " qnodes " << result.quiescenceNodes << " (" << result.getQuiescenceRate() * 100
+                  << "%) delta pruned " << result.deltaPrunes
+                  << " first move cutoffs " << result.getFirstMoveCutoffRate() * 100 << "%";
+        if (tablebase) {
+            std::cout << " tbhits " << result.tablebaseHits;
+        }
+        std::cout << std::endl;
+        std::cout << "hash " << table->getSizeBytes() / (1024 * 1024) << "MB full " << table->hashfull() / 10.0
+                  << "% hits " << lastTableStats.getHitRate() * 100 << "% cutoffs " << lastTableStats.getCutoffRate() * 100
+                  << "% collisions " << lastTableStats.getCollisionRate() * 100 << "%" << std::endl;
+    }
+    return result;
+}
+
+void SearchPlayer::iterativeDeepening(SearchWorker& worker, const GameState& root) {
+    worker.nodes = 0;
+    worker.tablebaseHits = 0;
+    worker.quiescenceNodes = 0;
+    worker.deltaPrunes = 0;
+    worker.betaCutoffs = 0;
+    worker.firstMoveCutoffs = 0;
+    worker.history.age();
+    worker.tableStats = TTStats{};
+    worker.previousPvLength = 0;
+
+    MoveList rootMoves;
+    root.generateMoves(rootMoves);
+
+    SearchResult& result = worker.result;
+    result = SearchResult{};
+    result.bestMove = rootMoves.empty() ? Move{} : rootMoves[0];
+
+    // Odd helpers start one ply deeper so the threads are not all on the
+    // same iteration at the same time
+    int startDepth = 1 + (worker.id % 2);
+
+    for (int depth = startDepth; depth <= maxDepth; depth++) {
+        worker.followPv = true;
+        int score = negamax(worker, root, depth, 0, -Evaluation::WIN_SCORE, Evaluation::WIN_SCORE);
+
+        // An unfinished iteration can't be trusted, keep the last one. Root
+        // moves it did finish were searched deeper, so the best of those
+        // is better than the last iteration's move.
+        if (stopped) {
+            if (worker.pvLength[0] > 0) {
+                result.bestMove = worker.pv[0][0];
+                worker.previousPvLength = worker.pvLength[0];
+                std::copy(worker.pv[0], worker.pv[0] + worker.pvLength[0], worker.previousPv);
+            }
+            break;
+        }
+
+        result.bestMove = worker.pv[0][0];
+        result.score = score;
+        result.depth = depth;
+
+        worker.previousPvLength = worker.pvLength[0];
+        std::copy(worker.pv[0], worker.pv[0] + worker.pvLength[0], worker.previousPv);
+
+        result.nodes = worker.nodes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (verbose && worker.id == 0 && !pondering) {
+            std::cout << "depth " << depth << " score " << score << " nodes " << worker.nodes
+                      << " nps " << static_cast<uint64_t>(result.getNodesPerSecond())
+                      << " time " << result.seconds << "s pv";
+            for (int i = 0; i < worker.pvLength[0]; i++) {
+                std::cout << " " << worker.pv[0][i].getPieceId() << worker.pv[0][i].getDirection();
+            }
+            std::cout << std::endl;
+        }
+
+        // A forced win or loss won't change with more depth
+        if (Evaluation::isWinScore(score) || rootMoves.size() == 1) break;
+
+        // The main thread decides when there's no time for another iteration
+        if (worker.id == 0 && timeControl.softExpired()) break;
+    }
+}
+
+bool SearchPlayer::timeUp(SearchWorker& worker) {
+    // Only the main thread looks at the clock
+    if (worker.id == 0 && worker.nodes % TIME_CHECK_INTERVAL == 0 && timeControl.hardExpired()) {
+        stopped = true;
+    }
+    return stopped.load(std::memory_order_relaxed);
+}
+
+void SearchPlayer::findExpectedReply(SearchWorker& worker, const GameState& root, SearchResult& result) {
+    result.hasExpectedReply = false;
+
+    GameState next = root;
+    next.play(result.bestMove);
+    if (next.isGameOver()) return;
+
+    // The principal variation usually has it, unless a table cutoff ended
+    // the line, then the table may still know the best reply
+    int action = -1;
+    if (worker.previousPvLength >= 2 && worker.previousPv[0] == result.bestMove) {
+        action = worker.previousPv[1].getActionIndex();
+    }
+    else {
+        TTEntry entry;
+        if (table->probe(next.hash, entry, worker.tableStats)) {
+            action = entry.action;
+        }
+    }
+    if (action < 0) return;
+
+    Move reply;
+    Constants::MOVE_RESULT moveResult = next.resolve(action / Constants::NUM_DIRECTIONS, action % Constants::NUM_DIRECTIONS, reply);
+    if (moveResult == Constants::MOVE_SUCCESS || moveResult == Constants::MOVE_KILLED) {
+        result.expectedReply = reply;
+        result.hasExpectedReply = true;
+    }
+}
+
+int SearchPlayer::negamax(SearchWorker& worker, const GameState& state, int depth, int ply, int alpha, int beta) {
+    // Settle captures and den threats before trusting the evaluation
+    if (depth == 0) {
+        return quiescence(worker, state, ply, alpha, beta);
+    }
+
+    worker.nodes++;
+    worker.pvLength[ply] = 0;
+
+    // The side that just moved reached the den
+    if (state.isGameOver()) {
+        return -Evaluation::WIN_SCORE + ply;
+    }
+
+    // Endgames in the tables are known exactly
+    int tableScore;
+    if (ply > 0 && probeTablebase(worker, state, ply, tableScore)) {
+        return tableScore;
+    }
+
+    if (ply >= Evaluation::MAX_PLY - 1) {
+        return evaluate(worker, state);
+    }
+
+    if (timeUp(worker)) return 0;
+
+    // Reuse what an earlier visit to this position found, possibly by
+    // another thread. The root always searches so it has a move to play.
+    TTEntry entry;
+    int hashAction = -1;
+    if (table->probe(state.hash, entry, worker.tableStats)) {
+        hashAction = entry.action;
+        int score = scoreFromTable(entry.score, ply);
+
+        if (ply > 0 && entry.depth >= depth &&
+            (entry.bound == Bound::Exact ||
+             (entry.bound == Bound::Lower && score >= beta) ||
+             (entry.bound == Bound::Upper && score <= alpha))) {
+            worker.tableStats.cutoffs++;
+            return score;
+        }
+    }
+
+    // Stay on the previous iteration's principal variation while we can,
+    // otherwise start with what the table suggests
+    bool followPv = worker.followPv && ply < worker.previousPvLength;
+    int tableAction = followPv ? worker.previousPv[ply].getActionIndex() : hashAction;
+    MovePicker picker(state, worker.history, tableAction, ply);
+
+    int originalAlpha = alpha;
+    int bestAction = -1;
+    int best = -Evaluation::WIN_SCORE;
+    int moveCount = 0;
+    Move move;
+    while (picker.next(move)) {
+        if (moveCount == 0) {
+            worker.followPv = followPv && move.getActionIndex() == tableAction;
+        }
+        moveCount++;
+
+        GameState next = state;
+        next.play(move);
+
+        // Principal variation search: the first move gets the full window,
+        // the rest only have to prove they are no better
+        int score;
+        if (moveCount == 1) {
+            score = -negamax(worker, next, depth - 1, ply + 1, -beta, -alpha);
+        }
+        else {
+            score = -negamax(worker, next, depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta && !stopped) {
+                score = -negamax(worker, next, depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+        if (stopped) return 0;
+
+        if (score > best) {
+            best = score;
+            bestAction = move.getActionIndex();
+
+            if (score > alpha) {
+                alpha = score;
+
+                worker.pv[ply][0] = move;
+                std::copy(worker.pv[ply + 1], worker.pv[ply + 1] + worker.pvLength[ply + 1], worker.pv[ply] + 1);
+                worker.pvLength[ply] = worker.pvLength[ply + 1] + 1;
+
+                if (alpha >= beta) {
+                    worker.betaCutoffs++;
+                    if (moveCount == 1) {
+                        worker.firstMoveCutoffs++;
+                    }
+                    if (MovePicker::isQuiet(state, move)) {
+                        worker.history.addCutoff(state, move, depth, ply);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // No legal moves loses
+    if (moveCount == 0) {
+        return -Evaluation::WIN_SCORE + ply;
+    }
+
+    Bound bound = best >= beta ? Bound::Lower : (best > originalAlpha ? Bound::Exact : Bound::Upper);
+    table->store(state.hash, scoreToTable(best, ply), depth, bound, bestAction, worker.tableStats);
+
+    return best;
+}
+
+int SearchPlayer::quiescence(SearchWorker& worker, const GameState& state, int ply, int alpha, int beta) {
+    worker.nodes++;
+    worker.quiescenceNodes++;
+    worker.pvLength[ply] = 0;
+
+    if (state.isGameOver()) {
+        return -Evaluation::WIN_SCORE + ply;
+    }
+
+    int tableScore;
+    if (probeTablebase(worker, state, ply, tableScore)) {
+        return tableScore;
+    }
+
+    if (ply >= Evaluation::MAX_PLY - 1) {
+        return evaluate(worker, state);
+    }
+
+    if (timeUp(worker)) return 0;
+
+    MoveList moves;
+    state.generateMoves(moves);
+
+    if (moves.empty()) {
+        return -Evaluation::WIN_SCORE + ply;
+    }
+
+    int side = state.sideToMove;
+    uint64_t enemy = state.occupied[side ^ 1];
+    int den = Bitboard::lsb(state.denMask[side]);
+
+    // Walking into the den wins on the spot, nothing else to look at
+    for (const Move& move : moves) {
+        if (move.to == den) {
+            return Evaluation::WIN_SCORE - ply - 1;
+        }
+    }
+
+    // An enemy piece next to our den walks in next move, so the position is
+    // not quiet and every move has to be tried. Otherwise the side to move
+    // can stand pat on the evaluation instead of making a tactical move.
+    int ownDen = Bitboard::lsb(state.denMask[side ^ 1]);
+    bool threatened = enemy & Bitboard::STEPS.neighbours[ownDen];
+
+    int best = -Evaluation::WIN_SCORE + ply;
+    int standPat = 0;
+    if (!threatened) {
+        standPat = evaluate(worker, state);
+        if (standPat >= beta) return standPat;
+        best = standPat;
+        alpha = std::max(alpha, standPat);
+    }
+
+    // Keep captures that win their battle and steps onto the traps around
+    // the den we attack, which threaten to walk in
+    uint64_t denTraps = state.trapMask & Bitboard::STEPS.neighbours[den];
+    int scores[Constants::MAX_MOVES];
+    int count = 0;
+    for (const Move& move : moves) {
+        uint64_t toBit = GameState::bit(move.to);
+        int score;
+        if (enemy & toBit) {
+            int owner;
+            int victim = state.pieceAt(move.to, owner);
+            bool wins = MovePicker::winsBattle(state, move, victim);
+            if (!threatened) {
+                if (!wins) continue;
+                // Delta pruning
+                if (standPat + Evaluation::PIECE_VALUE[victim] + DELTA_MARGIN <= alpha) {
+                    worker.deltaPrunes++;
+                    continue;
+                }
+            }
+            score = wins ? (1 << 20) + MovePicker::captureScore(move, victim) : -(1 << 20);
+        }
+        else if (denTraps & toBit) {
+            score = 0;
+        }
+        else if (threatened) {
+            score = -1;
+        }
+        else {
+            continue;
+        }
+        moves.moves[count] = move;
+        scores[count] = score;
+        count++;
+    }
+    moves.count = count;
+    sortMoves(moves, scores);
+
+    for (const Move& move : moves) {
+        GameState next = state;
+        next.play(move);
+
+        int score = -quiescence(worker, next, ply + 1, -beta, -alpha);
+        if (stopped) return 0;
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    return best;
+}
+
+bool SearchPlayer::probeTablebase(SearchWorker& worker, const GameState& state, int ply, int& score) {
+    if (!tablebase || __builtin_popcountll(state.occupied[0] | state.occupied[1]) > tablebase->getMaxPieces()) {
+        return false;
+    }
+
+    TBResult result;
+    if (!tablebase->probe(state, result)) return false;
+
+    worker.tablebaseHits++;
+    score = tablebaseScore(result, ply);
+    return true;
+}
+
+int SearchPlayer::evaluate(SearchWorker& worker, const GameState& state) {
+    return network ? networkEvaluate(worker, state) : Evaluation::evaluate(state);
+}
+
+int SearchPlayer::networkEvaluate(SearchWorker& worker, const GameState& state) {
+    MoveList moves;
+    state.generateMoves(moves);
+    if (moves.empty()) {
+        return Evaluation::evaluate(state);
+    }
+
+    // The worker's buffers keep their size, so this allocates nothing. Helper
+    // threads are new each search, so they don't use per-thread scratch.
+    worker.features.resize(network->getInputSize());
+    worker.qValues.resize(network->getOutputSize());
+    worker.activations.resize(network->getScratchSize());
+    // Seen from the side to move, so the best Q-value is its score
+    AIPlayer::moverToVector(state, worker.features.data());
+    network->predict(worker.features.data(), worker.qValues.data(), worker.activations.data());
+    const std::vector<float>& qValues = worker.qValues;
+
+    int side = state.sideToMove;
+    float best = qValues[AIPlayer::moverActionIndex(side, moves[0])];
+    for (const Move& move : moves) {
+        best = std::max(best, qValues[AIPlayer::moverActionIndex(side, move)]);
+    }
+
+    int score = static_cast<int>(best * NETWORK_SCALE);
+    return std::max(-Evaluation::WIN_BOUND + 1, std::min(Evaluation::WIN_BOUND - 1, score));
+}
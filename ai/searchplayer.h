@@ -0,0 +1,184 @@
+#ifndef __SEARCHPLAYER_H__
+#define __SEARCHPLAYER_H__
+
+#include "../game/player.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+#include "evaluation.h"
+#include "movepicker.h"
+#include "timecontrol.h"
+#include "transpositiontable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class AINetwork;
+class Board;
+class OpeningBook;
+class Tablebase;
+
+// What the last search found, for reporting and tools
+struct SearchResult {
+    Move bestMove;
+    Move expectedReply;        // what the principal variation answers with
+    bool hasExpectedReply;
+    int score;        // from the searching side's point of view
+    int depth;        // deepest iteration that completed
+    uint64_t nodes;
+    uint64_t quiescenceNodes;  // part of nodes spent past the depth limit
+    uint64_t deltaPrunes;      // captures quiescence didn't try
+    uint64_t betaCutoffs;
+    uint64_t firstMoveCutoffs; // cutoffs by the first move searched
+    uint64_t tablebaseHits;
+    double seconds;
+
+    double getNodesPerSecond() const { return seconds > 0 ? nodes / seconds : 0.0; }
+    double getQuiescenceRate() const { return nodes ? static_cast<double>(quiescenceNodes) / nodes : 0.0; }
+    // How often move ordering put the refutation first
+    double getFirstMoveCutoffRate() const { return betaCutoffs ? static_cast<double>(firstMoveCutoffs) / betaCutoffs : 0.0; }
+};
+
+// One search thread's own state. The threads only share the
+// transposition table and the stop flag.
+struct SearchWorker {
+    int id;         // 0 is the main thread, which keeps time and reports
+    uint64_t nodes;
+    uint64_t quiescenceNodes;
+    uint64_t deltaPrunes;
+    uint64_t betaCutoffs;
+    uint64_t firstMoveCutoffs;
+    uint64_t tablebaseHits;
+    TTStats tableStats;
+    MoveHistory history;
+    // Network input and output when scoring with the network
+    std::vector<float> features;
+    std::vector<float> qValues;
+    std::vector<float> activations;
+
+    // Principal variation of the current and the last completed iteration
+    Move pv[Evaluation::MAX_PLY][Evaluation::MAX_PLY];
+    int pvLength[Evaluation::MAX_PLY];
+    Move previousPv[Evaluation::MAX_PLY];
+    int previousPvLength;
+    bool followPv;
+
+    SearchResult result;
+};
+
+// Computer player that looks ahead with negamax alpha-beta and iterative
+// deepening over GameState copies, remembering results in a transposition
+// table between iterations and moves. At the depth limit a quiescence search
+// plays out captures and den threats, then positions are scored by
+// Evaluation::evaluate, or by the DQN's best Q-value once a model is loaded
+// with useNetwork.
+//
+// With more than one thread the search is Lazy SMP: helper threads run the
+// same iterative deepening from the same root, starting at staggered depths,
+// and help the main thread only through what they leave in the table.
+//
+// With endgame tables set, covered positions are scored from them instead of
+// searched, and a covered root is played straight from the tables. A root
+// in the opening book is played from the book.
+//
+// Time comes from a TimeControl. When the hard limit cuts an iteration
+// short, the best root move it finished is played. With pondering on, the
+// player searches the position after the reply it expects while the
+// opponent thinks. If that reply is played the search carries on, now on
+// the clock, otherwise it is thrown away.
+class SearchPlayer : public Player {
+private:
+    int maxDepth;
+    bool verbose;  // print a line per completed iteration
+    bool ponder;
+
+    std::unique_ptr<AINetwork> network;
+    std::shared_ptr<const OpeningBook> book;
+    std::shared_ptr<const Tablebase> tablebase;
+    std::unique_ptr<TranspositionTable> table;
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+
+    // Per-search state
+    TimeControl timeControl;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<bool> stopped;
+
+    SearchResult lastResult;
+    TTStats lastTableStats;
+
+    // Search on the opponent's time, from the position after the reply the
+    // last search expected. Reports nothing while pondering is set.
+    std::thread ponderThread;
+    std::atomic<bool> pondering;
+    GameState ponderRoot;
+    SearchResult ponderResult;
+    bool hasExpectedReply;
+    Move expectedReply;
+    uint64_t ponderHits;
+    uint64_t ponderMisses;
+
+    // search without starting the clock, which the caller has done
+    void startSearch();
+    SearchResult runSearch(const GameState& root);
+    // Stops the ponder search, true with its result if root is the
+    // position it was searching
+    bool finishPondering(const GameState& root, SearchResult& result);
+    void findExpectedReply(SearchWorker& worker, const GameState& root, SearchResult& result);
+
+    void iterativeDeepening(SearchWorker& worker, const GameState& root);
+    int negamax(SearchWorker& worker, const GameState& state, int depth, int ply, int alpha, int beta);
+    // Only winning captures, den entries and steps onto the traps by the
+    // enemy den, until the position is quiet
+    int quiescence(SearchWorker& worker, const GameState& state, int ply, int alpha, int beta);
+    bool probeTablebase(SearchWorker& worker, const GameState& state, int ply, int& score);
+    int evaluate(SearchWorker& worker, const GameState& state);
+    int networkEvaluate(SearchWorker& worker, const GameState& state);
+    bool timeUp(SearchWorker& worker);
+
+public:
+    SearchPlayer(int index, char startingPiece, int maxDepth = 64, int moveTimeMs = 1000, size_t hashMb = 16, int threads = 1);
+    ~SearchPlayer();
+
+    Move chooseMove(Board* board, const MoveList& legalMoves) override;
+    // With pondering on, searches the expected reply until the next chooseMove
+    void startPondering(Board* board) override;
+    void stopPondering() override;
+
+    // Iterative deepening from root until maxDepth or the time control
+    // stops it. root must have at least one legal move.
+    SearchResult search(const GameState& root);
+
+    // Score leaves with a trained DQN model instead of the static evaluation.
+    // The model plays as player 0, player 1's leaves are read turned round.
+    void useNetwork(const std::string& modelFile);
+
+    // Endgame tables from tbgen, shared with other players
+    void setTablebase(std::shared_ptr<const Tablebase> tables) { tablebase = std::move(tables); }
+    // Opening book from bookgen, shared with other players
+    void setOpeningBook(std::shared_ptr<const OpeningBook> openings) { book = std::move(openings); }
+
+    void setMaxDepth(int depth) { maxDepth = depth; }
+    void setMoveTime(int ms) { timeControl.setMoveTime(ms); }
+    // Plays on a game clock of ms in total instead of a fixed move time
+    void setClock(int64_t ms, int incrementMs) { timeControl.setClock(ms, incrementMs); }
+    const TimeControl& getTimeControl() const { return timeControl; }
+    void setPonder(bool value) { ponder = value; }
+    uint64_t getPonderHits() const { return ponderHits; }
+    uint64_t getPonderMisses() const { return ponderMisses; }
+    void setVerbose(bool value) { verbose = value; }
+    void setHashSize(size_t sizeMb) { table->resize(sizeMb); }
+    void setThreads(int threads);
+    int getThreads() const { return workers.size(); }
+    TranspositionTable& getTable() { return *table; }
+    const SearchResult& getLastResult() const { return lastResult; }
+    // Table statistics of the last search, summed over all threads
+    const TTStats& getTableStats() const { return lastTableStats; }
+};
+
+#endif
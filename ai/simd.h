@@ -0,0 +1,26 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <immintrin.h>
+
+// Small vector helpers shared by the float (gemv.cc) and int8
+// (quantizednetwork.cc) kernels. Each carries its own target attribute,
+// so only the kernels for that instruction set may call it.
+namespace Simd {
+    // Adds the two 256 bit halves. The zero masked extracts keep GCC 12
+    // from warning about the undefined start value of the plain ones.
+    __attribute__((target("avx512f")))
+    inline __m256 fold(__m512 sum) {
+        __m256 low = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(sum), 0));
+        __m256 high = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(sum), 1));
+        return _mm256_add_ps(low, high);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m256i fold(__m512i sum) {
+        return _mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xff, sum, 0),
+                                _mm512_maskz_extracti64x4_epi64(0xff, sum, 1));
+    }
+}
+
+#endif
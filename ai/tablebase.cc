@@ -0,0 +1,267 @@
+#include "tablebase.h"
+#include "../game/zobrist.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char MAGIC[4] = {'A', 'C', 'T', 'B'};
+    constexpr uint32_t VERSION = 1;
+
+    // Square seen from the other side of the board
+    int turn(int square) {
+        return Constants::NUM_SQUARES - 1 - square;
+    }
+
+    uint64_t turn(uint64_t mask) {
+        uint64_t turned = 0;
+        for (int square = 0; square < Constants::NUM_SQUARES; square++) {
+            if (mask & GameState::bit(square)) {
+                turned |= GameState::bit(turn(square));
+            }
+        }
+        return turned;
+    }
+
+    // Win fastest, then draw, then lose slowest
+    int rank(const TBResult& result) {
+        if (result.wdl == WDL::Win) return 1000 - result.dtm;
+        if (result.wdl == WDL::Loss) return -1000 + result.dtm;
+        return 0;
+    }
+}
+
+Tablebase::Tablebase()
+    : tables{}, maxPieces(0), trapMask(0), waterMask(0), denMask{0, 0}
+{
+}
+
+Tablebase::~Tablebase() {
+    close();
+}
+
+bool Tablebase::open(const std::string& filename) {
+    close();
+
+    if (!file.open(filename)) {
+        return false;
+    }
+    if (file.getSize() < sizeof(FileHeader)) {
+        std::cerr << "Error: " << filename << " is not a tablebase" << std::endl;
+        close();
+        return false;
+    }
+
+    const uint8_t* base = file.getData();
+    size_t size = file.getSize();
+    const FileHeader& header = *reinterpret_cast<const FileHeader*>(base);
+    size_t entriesEnd = sizeof(FileHeader) + size_t(header.tableCount) * sizeof(FileEntry);
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.maxPieces > MAX_PIECES || entriesEnd > size) {
+        std::cerr << "Error: " << filename << " is not a tablebase" << std::endl;
+        close();
+        return false;
+    }
+
+    const FileEntry* entries = reinterpret_cast<const FileEntry*>(base + sizeof(FileHeader));
+    for (uint32_t i = 0; i < header.tableCount; i++) {
+        const FileEntry& entry = entries[i];
+        if (entry.key >= TABLE_COUNT || entry.pieces != static_cast<uint32_t>(pieceCount(entry.key)) ||
+            entry.offset + tableSize(entry.pieces) > size) {
+            std::cerr << "Error: Tablebase " << filename << " is damaged" << std::endl;
+            close();
+            return false;
+        }
+        tables[entry.key] = base + entry.offset;
+    }
+
+    trapMask = header.trapMask;
+    waterMask = header.waterMask;
+    denMask[0] = header.denMask[0];
+    denMask[1] = header.denMask[1];
+    maxPieces = header.maxPieces;
+    return true;
+}
+
+void Tablebase::close() {
+    file.close();
+    std::fill(tables, tables + TABLE_COUNT, nullptr);
+    maxPieces = 0;
+}
+
+void Tablebase::setLayout(const GameState& layout, int pieces) {
+    trapMask = layout.trapMask;
+    waterMask = layout.waterMask;
+    denMask[0] = layout.denMask[0];
+    denMask[1] = layout.denMask[1];
+    maxPieces = pieces;
+}
+
+bool Tablebase::probeTrivial(const GameState& state, TBResult& result) const {
+    int side = state.sideToMove;
+
+    // The other side reached the den, or we have nothing left to move
+    if (state.isGameOver() || !state.occupied[side]) {
+        result = TBResult{WDL::Loss, 0};
+        return true;
+    }
+
+    // Any move leaves the other side without a move
+    if (!state.occupied[side ^ 1]) {
+        MoveList moves;
+        state.generateMoves(moves);
+        result = moves.empty() ? TBResult{WDL::Loss, 0} : TBResult{WDL::Win, 1};
+        return true;
+    }
+    return false;
+}
+
+bool Tablebase::probe(const GameState& state, TBResult& result) const {
+    if (!isOpen()) return false;
+    if (probeTrivial(state, result)) return true;
+
+    if (state.trapMask != trapMask || state.waterMask != waterMask ||
+        state.denMask[0] != denMask[0] || state.denMask[1] != denMask[1]) {
+        return false;
+    }
+
+    int key;
+    uint32_t index;
+    if (!locate(state, key, index) || pieceCount(key) > maxPieces || !tables[key]) {
+        return false;
+    }
+
+    result = decode(tables[key][index]);
+    return true;
+}
+
+bool Tablebase::bestMove(const GameState& state, Move& move, TBResult& result) const {
+    if (!isOpen() || state.isGameOver()) return false;
+
+    MoveList moves;
+    state.generateMoves(moves);
+    if (moves.empty()) return false;
+
+    int bestRank = 0;
+    for (int i = 0; i < moves.size(); i++) {
+        GameState next = state;
+        next.play(moves[i]);
+
+        TBResult reply;
+        if (!probe(next, reply)) return false;
+
+        // The reply's result turned round, one ply further away
+        TBResult ours{WDL::Draw, 0};
+        if (reply.wdl == WDL::Loss) ours = TBResult{WDL::Win, reply.dtm + 1};
+        if (reply.wdl == WDL::Win) ours = TBResult{WDL::Loss, reply.dtm + 1};
+
+        if (i == 0 || rank(ours) > bestRank) {
+            bestRank = rank(ours);
+            move = moves[i];
+            result = ours;
+        }
+    }
+    return true;
+}
+
+bool Tablebase::locate(const GameState& state, int& key, uint32_t& index) {
+    int side = state.sideToMove;
+    int count = 0;
+    key = 0;
+    index = 0;
+
+    // Side to move first, both seen from player 0's end of the board
+    for (int p = 0; p < 2; p++) {
+        int player = side ^ p;
+        for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+            int square = state.pieceSquare[player][piece];
+            if (square < 0) continue;
+
+            if (++count > MAX_PIECES) return false;
+            key |= 1 << (p * Constants::NUM_PIECES + piece);
+            index = index * Constants::NUM_SQUARES + (side ? turn(square) : square);
+        }
+    }
+
+    int moverMask = (1 << Constants::NUM_PIECES) - 1;
+    return (key & moverMask) && (key >> Constants::NUM_PIECES);
+}
+
+int Tablebase::pieceCount(int key) {
+    return __builtin_popcount(key);
+}
+
+size_t Tablebase::tableSize(int pieces) {
+    size_t size = 1;
+    for (int i = 0; i < pieces; i++) {
+        size *= Constants::NUM_SQUARES;
+    }
+    return size;
+}
+
+bool Tablebase::setup(int key, uint32_t index, GameState& state) {
+    int count = pieceCount(key);
+    int squares[MAX_PIECES];
+    for (int i = count - 1; i >= 0; i--) {
+        squares[i] = index % Constants::NUM_SQUARES;
+        index /= Constants::NUM_SQUARES;
+    }
+
+    std::memset(state.pieceSquare, -1, sizeof(state.pieceSquare));
+    state.occupied[0] = state.occupied[1] = 0;
+    state.sideToMove = 0;
+    state.winner = -1;
+
+    int next = 0;
+    for (int p = 0; p < 2; p++) {
+        for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+            if (!(key & (1 << (p * Constants::NUM_PIECES + piece)))) continue;
+
+            int square = squares[next++];
+            uint64_t mask = GameState::bit(square);
+            if ((state.occupied[0] | state.occupied[1] | state.denMask[0] | state.denMask[1]) & mask) {
+                return false;
+            }
+            if (piece != 0 && (state.waterMask & mask)) {
+                return false;
+            }
+
+            state.pieceSquare[p][piece] = square;
+            state.occupied[p] |= mask;
+        }
+    }
+
+    state.hash = Zobrist::hash(state);
+    return true;
+}
+
+bool Tablebase::isSymmetric(const GameState& layout) {
+    return turn(layout.trapMask) == layout.trapMask && turn(layout.waterMask) == layout.waterMask &&
+           turn(layout.denMask[0]) == layout.denMask[1];
+}
+
+Tablebase::FileHeader Tablebase::makeHeader(const GameState& layout, int pieces, uint32_t tableCount) {
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.maxPieces = pieces;
+    header.tableCount = tableCount;
+    header.trapMask = layout.trapMask;
+    header.waterMask = layout.waterMask;
+    header.denMask[0] = layout.denMask[0];
+    header.denMask[1] = layout.denMask[1];
+    return header;
+}
+
+uint8_t Tablebase::encode(WDL wdl, int dtm) {
+    return wdl == WDL::Draw ? 0 : dtm + 1;
+}
+
+TBResult Tablebase::decode(uint8_t value) {
+    if (value == 0) return TBResult{WDL::Draw, 0};
+
+    int dtm = value - 1;
+    return TBResult{dtm % 2 ? WDL::Win : WDL::Loss, dtm};
+}
@@ -0,0 +1,115 @@
+#ifndef __TABLEBASE_H__
+#define __TABLEBASE_H__
+
+#include "mappedfile.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Game result for the side to move
+enum class WDL : int8_t {Loss = -1, Draw = 0, Win = 1};
+
+struct TBResult {
+    WDL wdl;
+    int dtm;  // plies until the game ends with best play, 0 for a draw
+};
+
+// Endgame tables written by tools/tbgen and read through mmap.
+//
+// A table covers one material combination: the pieces of the side to move
+// and the pieces of the other side. The board looks the same turned 180
+// degrees, so a position with player 1 to move is looked up turned round
+// with the colours swapped, and every table has player 0 to move.
+//
+// A position is one byte at a fixed index in its table: 0 for a draw,
+// otherwise dtm + 1, where an odd dtm is a win for the side to move and an
+// even one a loss.
+class Tablebase {
+public:
+    // 63^5 positions still fit a 32 bit index
+    static constexpr int MAX_PIECES = 5;
+    static constexpr int TABLE_COUNT = 1 << (2 * Constants::NUM_PIECES);
+    static constexpr int MAX_DTM = 253;
+
+    // File layout: header, one entry per table, then the tables
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t maxPieces;
+        uint32_t tableCount;
+        uint64_t trapMask;
+        uint64_t waterMask;
+        uint64_t denMask[2];
+    };
+
+    struct FileEntry {
+        uint32_t key;
+        uint32_t pieces;
+        uint64_t offset;  // from the start of the file
+    };
+
+private:
+    const uint8_t* tables[TABLE_COUNT];
+    int maxPieces;
+
+    // Board the tables were made for
+    uint64_t trapMask;
+    uint64_t waterMask;
+    uint64_t denMask[2];
+
+    MappedFile file;
+
+    // Positions no table is needed for: the game is over or one side has
+    // no pieces left
+    bool probeTrivial(const GameState& state, TBResult& result) const;
+
+public:
+    Tablebase();
+    ~Tablebase();
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    // Maps a file written by tbgen, false (with a message) if it can't be used
+    bool open(const std::string& filename);
+    void close();
+
+    // For tbgen: tables filled in memory for positions on layout
+    void setLayout(const GameState& layout, int pieces);
+    void setTable(int key, const uint8_t* data) { tables[key] = data; }
+
+    int getMaxPieces() const { return maxPieces; }
+    bool isOpen() const { return maxPieces > 0; }
+
+    // O(1) lookup, false if state is not covered
+    bool probe(const GameState& state, TBResult& result) const;
+
+    // The move that wins fastest, draws, or loses slowest, false if the
+    // position or one of its successors is not covered
+    bool bestMove(const GameState& state, Move& move, TBResult& result) const;
+
+    // Which table state belongs to and where in it. The key has the side to
+    // move's pieces in the low byte. False when a side has no pieces or
+    // there are more than MAX_PIECES.
+    static bool locate(const GameState& state, int& key, uint32_t& index);
+    static int pieceCount(int key);
+    static size_t tableSize(int pieces);
+
+    // Inverse of locate: places the pieces of key on layout with player 0
+    // to move. False if the squares can't all hold their pieces.
+    static bool setup(int key, uint32_t index, GameState& state);
+
+    // Traps, water and dens look the same after a 180 degree turn
+    static bool isSymmetric(const GameState& layout);
+
+    // Header for a file of tableCount tables made on layout
+    static FileHeader makeHeader(const GameState& layout, int pieces, uint32_t tableCount);
+
+    static uint8_t encode(WDL wdl, int dtm);
+    static TBResult decode(uint8_t value);
+};
+
+#endif
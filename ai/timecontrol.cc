@@ -0,0 +1,79 @@
+#include "timecontrol.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // A clock is shared out as if this many moves were still to come
+    constexpr int64_t MOVES_TO_GO = 30;
+
+    // Kept back from the clock for the moves themselves to be made
+    constexpr int64_t CLOCK_MARGIN_MS = 50;
+
+    // An iteration started after half the budget would rarely finish
+    // inside it, the next one usually takes longer than all before it
+    constexpr int64_t SOFT_SHARE = 2;
+
+    // A move may run past its budget up to this many times over, when the
+    // clock has the time
+    constexpr int64_t HARD_FACTOR = 3;
+
+    constexpr int64_t NEVER = std::numeric_limits<int64_t>::max();
+}
+
+TimeControl::TimeControl(int moveTimeMs)
+    : moveTimeMs(moveTimeMs), clockMs(0), incrementMs(0), moveStart(0), softDeadline(NEVER), hardDeadline(NEVER)
+{
+}
+
+int64_t TimeControl::ticks(int64_t ms) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(ms)).count();
+}
+
+void TimeControl::setMoveTime(int ms) {
+    moveTimeMs = ms;
+    clockMs = 0;
+}
+
+void TimeControl::setClock(int64_t ms, int increment) {
+    clockMs = std::max<int64_t>(ms, 1);
+    incrementMs = increment;
+}
+
+void TimeControl::startMove() {
+    int64_t start = now();
+    int64_t softMs;
+    int64_t hardMs;
+    if (usesClock()) {
+        int64_t available = std::max<int64_t>(clockMs - CLOCK_MARGIN_MS, 1);
+        int64_t budget = std::min(available, clockMs / MOVES_TO_GO + incrementMs * 3 / 4);
+        softMs = budget / SOFT_SHARE;
+        hardMs = std::min(available, budget * HARD_FACTOR);
+    }
+    else {
+        // A fixed move time is all used, as a hard limit
+        softMs = moveTimeMs;
+        hardMs = moveTimeMs;
+    }
+
+    moveStart = start;
+    softDeadline = start + ticks(softMs);
+    hardDeadline = start + ticks(hardMs);
+}
+
+void TimeControl::startInfinite() {
+    moveStart = now();
+    softDeadline = NEVER;
+    hardDeadline = NEVER;
+}
+
+void TimeControl::finishMove() {
+    if (usesClock()) {
+        clockMs = std::max<int64_t>(clockMs - getElapsedMs(), 1) + incrementMs;
+    }
+}
+
+int64_t TimeControl::getElapsedMs() const {
+    Clock::duration elapsed{now() - moveStart.load(std::memory_order_relaxed)};
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
@@ -0,0 +1,52 @@
+#ifndef __TIMECONTROL_H__
+#define __TIMECONTROL_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// When a search has to stop, either after a fixed time per move or after a
+// share of what is left on a game clock. Each move gets two limits: past
+// the soft one no new iteration is started, at the hard one the search
+// stops where it is and plays the best move found so far.
+//
+// The limits are atomics so a ponder search running without limits can be
+// put on the clock from another thread when the expected move is played.
+class TimeControl {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int moveTimeMs;     // fixed time per move, used when clockMs is 0
+    int64_t clockMs;    // time left on a game clock
+    int incrementMs;    // added to the clock after each move
+
+    std::atomic<int64_t> moveStart;     // Clock ticks
+    std::atomic<int64_t> softDeadline;
+    std::atomic<int64_t> hardDeadline;
+
+    static int64_t now() { return Clock::now().time_since_epoch().count(); }
+    static int64_t ticks(int64_t ms);
+
+public:
+    explicit TimeControl(int moveTimeMs);
+
+    void setMoveTime(int ms);
+    // A game clock with ms left in total, replaces the fixed move time
+    void setClock(int64_t ms, int increment);
+    bool usesClock() const { return clockMs > 0; }
+    int64_t getClockMs() const { return clockMs; }
+
+    // Starts timing a move and works out its limits
+    void startMove();
+    // No limits until startMove, for thinking on the opponent's time
+    void startInfinite();
+    // Charges the time since startMove to the clock and adds the increment
+    void finishMove();
+
+    bool softExpired() const { return now() >= softDeadline.load(std::memory_order_relaxed); }
+    bool hardExpired() const { return now() >= hardDeadline.load(std::memory_order_relaxed); }
+    // Time for this move so far
+    int64_t getElapsedMs() const;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "transpositiontable.h"
+
+#include <cstdint>
+#include <new>
+
+namespace {
+    // Layout of Entry::data, low bits first
+    constexpr int DEPTH_SHIFT = 32;
+    constexpr int BOUND_SHIFT = 40;
+    constexpr int ACTION_SHIFT = 42;
+    constexpr int GENERATION_SHIFT = 48;
+
+    constexpr uint64_t GENERATION_MASK = (1 << 6) - 1;
+
+    // An entry one generation older is worth this much less depth
+    constexpr int AGE_PENALTY = 4;
+}
+
+TranspositionTable::TranspositionTable(size_t sizeMb)
+    : buckets(nullptr), bucketCount(0), generation(0)
+{
+    resize(sizeMb);
+}
+
+void TranspositionTable::resize(size_t sizeMb) {
+    size_t bytes = (sizeMb > 0 ? sizeMb : 1) * 1024 * 1024;
+
+    bucketCount = 1;
+    while (bucketCount * 2 * sizeof(Bucket) <= bytes) {
+        bucketCount *= 2;
+    }
+
+    storage.reset(new char[bucketCount * sizeof(Bucket) + alignof(Bucket)]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+    address = (address + alignof(Bucket) - 1) & ~uintptr_t(alignof(Bucket) - 1);
+    buckets = reinterpret_cast<Bucket*>(address);
+
+    for (size_t i = 0; i < bucketCount; i++) {
+        new (&buckets[i]) Bucket();
+    }
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; i++) {
+        for (Entry& slot : buckets[i].entries) {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+TTStats& TTStats::operator+=(const TTStats& other) {
+    probes += other.probes;
+    hits += other.hits;
+    cutoffs += other.cutoffs;
+    stores += other.stores;
+    collisions += other.collisions;
+    return *this;
+}
+
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) & GENERATION_MASK;
+}
+
+uint64_t TranspositionTable::pack(int score, int depth, Bound bound, int action, int generation) {
+    return uint64_t(uint32_t(score))
+         | uint64_t(uint8_t(depth)) << DEPTH_SHIFT
+         | uint64_t(bound) << BOUND_SHIFT
+         | uint64_t(action + 1) << ACTION_SHIFT
+         | uint64_t(generation) << GENERATION_SHIFT;
+}
+
+TTEntry TranspositionTable::unpack(uint64_t data) {
+    TTEntry entry;
+    entry.score = int32_t(uint32_t(data));
+    entry.depth = uint8_t(data >> DEPTH_SHIFT);
+    entry.bound = Bound((data >> BOUND_SHIFT) & 3);
+    entry.action = int((data >> ACTION_SHIFT) & 63) - 1;
+    return entry;
+}
+
+int TranspositionTable::generationOf(uint64_t data) {
+    return (data >> GENERATION_SHIFT) & GENERATION_MASK;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry, TTStats& stats) {
+    stats.probes++;
+    Bucket& bucket = buckets[key & (bucketCount - 1)];
+
+    for (Entry& slot : bucket.entries) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+        if (data && (check ^ data) == key) {
+            // Still useful, don't let it age out
+            uint64_t refreshed = (data & ~(GENERATION_MASK << GENERATION_SHIFT)) | uint64_t(generation) << GENERATION_SHIFT;
+            if (refreshed != data) {
+                slot.data.store(refreshed, std::memory_order_relaxed);
+                slot.check.store(key ^ refreshed, std::memory_order_relaxed);
+            }
+
+            entry = unpack(data);
+            stats.hits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int score, int depth, Bound bound, int action, TTStats& stats) {
+    stats.stores++;
+    Bucket& bucket = buckets[key & (bucketCount - 1)];
+
+    Entry* replace = &bucket.entries[0];
+    uint64_t replaceData = 0;
+    int replaceValue = INT32_MAX;
+
+    for (Entry& slot : bucket.entries) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+        if (data && (check ^ data) == key) {
+            TTEntry old = unpack(data);
+
+            // Keep a deeper result for this position unless the new one is exact
+            if (bound != Bound::Exact && depth < old.depth && generationOf(data) == generation) {
+                return;
+            }
+            if (action < 0) {
+                action = old.action;
+            }
+            replace = &slot;
+            replaceData = 0;
+            break;
+        }
+
+        if (!data) {
+            if (replaceValue > INT32_MIN) {
+                replace = &slot;
+                replaceData = 0;
+                replaceValue = INT32_MIN;
+            }
+            continue;
+        }
+
+        int age = (generation - generationOf(data)) & GENERATION_MASK;
+        int value = unpack(data).depth - AGE_PENALTY * age;
+        if (value < replaceValue) {
+            replace = &slot;
+            replaceData = data;
+            replaceValue = value;
+        }
+    }
+
+    if (replaceData) {
+        stats.collisions++;
+    }
+
+    uint64_t data = pack(score, depth, bound, action, generation);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = bucketCount < 250 ? bucketCount : 250;
+    int used = 0;
+
+    for (size_t i = 0; i < sample; i++) {
+        for (const Entry& slot : buckets[i].entries) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if (data && generationOf(data) == generation) {
+                used++;
+            }
+        }
+    }
+    return used * 1000 / int(sample * ENTRIES_PER_BUCKET);
+}
@@ -0,0 +1,101 @@
+#ifndef __TRANSPOSITIONTABLE_H__
+#define __TRANSPOSITIONTABLE_H__
+
+#include "../game/move.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Kind of score a table entry holds, from an alpha-beta search
+enum class Bound : uint8_t {
+    Empty,  // nothing stored (not None, X11 defines that)
+    Upper,  // failed low, the real score is at most this
+    Lower,  // failed high, the real score is at least this
+    Exact
+};
+
+// What a probe hands back to the search
+struct TTEntry {
+    int score;
+    int depth;
+    Bound bound;
+    int action;  // Move::getActionIndex of the best move, -1 if none
+};
+
+// Counted by each search thread for itself, then added up
+struct TTStats {
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t cutoffs;     // hits the search could return from directly
+    uint64_t stores;
+    uint64_t collisions;  // stores that evicted another position's entry
+
+    double getHitRate() const { return probes ? double(hits) / probes : 0.0; }
+    double getCutoffRate() const { return probes ? double(cutoffs) / probes : 0.0; }
+    double getCollisionRate() const { return stores ? double(collisions) / stores : 0.0; }
+
+    TTStats& operator+=(const TTStats& other);
+};
+
+// Fixed-size hash table of search results keyed by Zobrist hash. Entries
+// live in 64 byte buckets (one cache line, four entries). The index comes
+// from the low bits of the key and the whole key is kept to check hits.
+// Within a bucket the shallowest entry is replaced, with entries from
+// older searches counting as shallower the older they get.
+//
+// Search threads share one table without locks. Each entry is two atomic
+// words, the key stored XORed with the data, so a probe that reads halves
+// of two different writes sees a key mismatch and treats it as a miss.
+class TranspositionTable {
+private:
+    static constexpr int ENTRIES_PER_BUCKET = 4;
+    static constexpr int GENERATION_BITS = 6;
+
+    // 16 bytes: the position key XOR data, then score, depth, bound, move
+    // and search generation packed into one word
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+
+    static_assert(sizeof(Bucket) == 64, "a bucket must fill exactly one cache line");
+
+    std::unique_ptr<char[]> storage;  // over-allocated so buckets can be aligned
+    Bucket* buckets;
+    size_t bucketCount;               // power of two
+    uint8_t generation;               // only changed between searches
+
+    static uint64_t pack(int score, int depth, Bound bound, int action, int generation);
+    static TTEntry unpack(uint64_t data);
+    static int generationOf(uint64_t data);
+
+public:
+    // Uses the largest power-of-two number of buckets that fits in sizeMb
+    explicit TranspositionTable(size_t sizeMb = 16);
+
+    void resize(size_t sizeMb);
+    void clear();
+
+    // Call once per root search, before any thread starts, so old entries
+    // age out
+    void newSearch();
+
+    // Safe to call from many threads at once. stats is the caller's own,
+    // the search also counts stats.cutoffs itself.
+    bool probe(uint64_t key, TTEntry& entry, TTStats& stats);
+    void store(uint64_t key, int score, int depth, Bound bound, int action, TTStats& stats);
+
+    size_t getSizeBytes() const { return bucketCount * sizeof(Bucket); }
+    size_t getEntryCount() const { return bucketCount * ENTRIES_PER_BUCKET; }
+
+    // Rough fill in per mille, from a sample of buckets
+    int hashfull() const;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "bitboard.h"
+
+#include "constants.h"
+#include "gamestate.h"
+#include "move.h"
+
+
+void Bitboard::generateMoves(const GameState& state, MoveList& moves) {
+    moves.clear();
+    if (state.isGameOver()) return;
+
+    int side = state.sideToMove;
+    uint64_t own = state.occupied[side];
+    uint64_t enemy = state.occupied[side ^ 1];
+    uint64_t empty = ~(own | enemy);
+    uint64_t water = state.waterMask;
+    uint64_t traps = state.trapMask;
+
+    // Squares no piece may end on: own pieces and our own den
+    uint64_t blocked = own | state.denMask[side ^ 1];
+
+    int enemyRat = state.pieceSquare[side ^ 1][0];
+    uint64_t enemyRatBit = (enemyRat >= 0 && !(traps & GameState::bit(enemyRat))) ? GameState::bit(enemyRat) : 0;
+
+    Move move;
+    for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+        int from = state.pieceSquare[side][piece];
+        if (from < 0) continue;
+
+        uint64_t fromBit = GameState::bit(from);
+        bool isRat = (piece == 0);
+        bool leaps = (piece == 5 || piece == 6);
+        bool fromTrap = traps & fromBit;
+
+        // Only rats may end on water (a leaper stopped by a rat ends on water too)
+        uint64_t allowed = ~blocked;
+        if (!isRat) {
+            allowed &= ~water;
+        }
+        else {
+            // A rat cannot attack across the water's edge. Trapped pieces have
+            // strength 0, so the rule then only applies against a free rat
+            uint64_t otherTerrain = (water & fromBit) ? ~water : water;
+            uint64_t noAttack = fromTrap ? (otherTerrain & enemyRatBit) : (otherTerrain & ~traps);
+            allowed &= ~(noAttack & enemy);
+        }
+
+        move.piece = piece;
+        move.from = from;
+
+        for (int dir = 0; dir < Constants::NUM_DIRECTIONS; dir++) {
+            uint64_t target = STEPS.step[dir][from];
+
+            // Across the river in one lookup, a piece in the water (a rat)
+            // stops the leap on its square
+            if (leaps && (target & water)) {
+                const LeapTable& leap = leapTable(water);
+                uint64_t blockers = leap.crossed[dir][from] & ~empty;
+                target = blockers ? GameState::bit(LeapTable::firstBlocker(dir, blockers)) : leap.landing[dir][from];
+            }
+
+            if (!(target & allowed)) continue;
+
+            move.dir = dir;
+            move.to = lsb(target);
+            moves.add(move);
+        }
+    }
+}
+
+
+void Bitboard::LeapTable::init(uint64_t water) {
+    for (int dir = 0; dir < Constants::NUM_DIRECTIONS; dir++) {
+        for (int sq = 0; sq < Constants::NUM_SQUARES; sq++) {
+            uint64_t target = STEPS.step[dir][sq];
+            uint64_t jumped = 0;
+            int steps = 1;
+
+            while (target & water) {
+                jumped |= target;
+                target = STEPS.step[dir][lsb(target)];
+                steps++;
+            }
+
+            distance[dir][sq] = steps;
+            landing[dir][sq] = target;
+            crossed[dir][sq] = jumped;
+        }
+    }
+}
+
+
+const Bitboard::LeapTable& Bitboard::leapTable(uint64_t water) {
+    // Bit 63 is past the playable area, so no layout matches before the first init
+    thread_local LeapTable table;
+    thread_local uint64_t tableWater = ~uint64_t(0);
+
+    if (water != tableWater) {
+        table.init(water);
+        tableWater = water;
+    }
+    return table;
+}
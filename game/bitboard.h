@@ -0,0 +1,111 @@
+#ifndef __BITBOARD_H__
+#define __BITBOARD_H__
+
+#include "constants.h"
+
+#include <cstdint>
+
+
+struct GameState;
+struct MoveList;
+
+// 64 bit masks over the 7x9 playable area, bit n is GameState square n.
+namespace Bitboard {
+    constexpr uint64_t FULL = (uint64_t(1) << Constants::NUM_SQUARES) - 1;
+
+    // Single-square destination of a one step move, 0 if it would hit the wall
+    struct StepTable {
+        uint64_t step[Constants::NUM_DIRECTIONS][Constants::NUM_SQUARES];
+        uint64_t neighbours[Constants::NUM_SQUARES];
+
+        constexpr StepTable() : step{}, neighbours{} {
+            for (int sq = 0; sq < Constants::NUM_SQUARES; sq++) {
+                for (int dir = 0; dir < Constants::NUM_DIRECTIONS; dir++) {
+                    int row = sq / Constants::PLAYABLE_WIDTH + Constants::DIRECTION_ROW_STEP[dir];
+                    int col = sq % Constants::PLAYABLE_WIDTH + Constants::DIRECTION_COL_STEP[dir];
+                    if (row < 0 || row >= Constants::PLAYABLE_LENGTH || col < 0 || col >= Constants::PLAYABLE_WIDTH) {
+                        continue;
+                    }
+                    step[dir][sq] = uint64_t(1) << (row * Constants::PLAYABLE_WIDTH + col);
+                    neighbours[sq] |= step[dir][sq];
+                }
+            }
+        }
+    };
+
+    // Outcome of MovementSystem::battle indexed by effective strength
+    // (GamePiece::getStrength, so 0 when trapped), true if the attacker wins
+    struct BattleTable {
+        bool attackerWins[Constants::NUM_PIECES + 1][Constants::NUM_PIECES + 1];
+
+        constexpr BattleTable() : attackerWins{} {
+            for (int atk = 0; atk <= Constants::NUM_PIECES; atk++) {
+                for (int def = 0; def <= Constants::NUM_PIECES; def++) {
+                    if (atk == 1 && def == 8) {
+                        attackerWins[atk][def] = true;  // rat beats elephant
+                    }
+                    else if (atk == 8 && def == 1) {
+                        attackerWins[atk][def] = false;
+                    }
+                    else {
+                        attackerWins[atk][def] = atk >= def;
+                    }
+                }
+            }
+        }
+    };
+
+    // Where a tiger or lion lands for every square and direction. The river
+    // layout comes from the board file, so this is filled in at runtime.
+    struct LeapTable {
+        // Steps to the landing tile. It can be a wall or den tile just past
+        // the playable area, which the caller then rejects.
+        uint8_t distance[Constants::NUM_DIRECTIONS][Constants::NUM_SQUARES];
+        // Landing square as a mask, 0 when it is past the playable area
+        uint64_t landing[Constants::NUM_DIRECTIONS][Constants::NUM_SQUARES];
+        // Water squares jumped over, any piece on them (a rat) blocks the jump
+        uint64_t crossed[Constants::NUM_DIRECTIONS][Constants::NUM_SQUARES];
+
+        void init(uint64_t water);
+
+        // First piece in the way, call only if crossed & occupied
+        static int firstBlocker(int dir, uint64_t blockers) {
+            // S and E walk towards higher squares, N and W towards lower ones
+            return (dir == 1 || dir == 2) ? __builtin_ctzll(blockers) : 63 - __builtin_clzll(blockers);
+        }
+
+        // Steps to the first piece in the way, call only if crossed & occupied
+        static int blockerDistance(int dir, int square, uint64_t blockers) {
+            int blocker = firstBlocker(dir, blockers);
+            int rows = blocker / Constants::PLAYABLE_WIDTH - square / Constants::PLAYABLE_WIDTH;
+            int cols = blocker % Constants::PLAYABLE_WIDTH - square % Constants::PLAYABLE_WIDTH;
+            return (rows < 0 ? -rows : rows) + (cols < 0 ? -cols : cols);
+        }
+    };
+
+    constexpr StepTable STEPS{};
+    constexpr BattleTable BATTLE{};
+
+    static_assert(BATTLE.attackerWins[1][8] && !BATTLE.attackerWins[8][1], "rat beats elephant");
+    static_assert(BATTLE.attackerWins[0][0] && !BATTLE.attackerWins[0][1], "trapped pieces have strength 0");
+
+    inline int lsb(uint64_t mask) {
+        return __builtin_ctzll(mask);
+    }
+
+    inline int popLsb(uint64_t& mask) {
+        int sq = lsb(mask);
+        mask &= mask - 1;
+        return sq;
+    }
+
+    // Leap table for the river in water. Each thread keeps the last one it
+    // built, and a game only has one layout, so this is a compare after the
+    // first call.
+    const LeapTable& leapTable(uint64_t water);
+
+    // Writes every legal move for the side to move into moves
+    void generateMoves(const GameState& state, MoveList& moves);
+}
+
+#endif
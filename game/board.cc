@@ -1,5 +1,6 @@
 #include "board.h"
 
+#include "bitboard.h"
 #include "gamepiece.h"
 #include "constants.h"
 #include "controller.h"
@@ -8,6 +9,7 @@
 #include "goaleffect.h"
 #include "tile.h"
 #include "tileeffect.h"
+#include "zobrist.h"
 
 #include <cassert>
 #include <cctype>
@@ -20,7 +22,8 @@
 #include <utility>
 
 
-Board::Board(int length, int width, Controller* controller) : length{length}, width{width}, controller{controller} {}
+Board::Board(int length, int width, Controller* controller) : length{length}, width{width}, controller{controller}, players{nullptr}, hash{0}, sideToMove{0},
+      trapMask{0}, waterMask{0}, denMask{0, 0}, occupancy{0}, undoCount{0} {}
 
 
 bool Board::init(std::vector<std::string> layout, std::vector<Player>& players) {
@@ -33,6 +36,7 @@ bool Board::init(std::vector<std::string> layout, std::vector<Player>& players)
     assert(width == givenWidth);
 
     board.reserve(height);
+    this->players = &players;
 
     for (int r = 0; r < height; r++) {
         size_t width = layout[r].size();
@@ -89,6 +93,13 @@ bool Board::init(std::vector<std::string> layout, std::vector<Player>& players)
         }
     }
 
+    updateTerrainMasks();
+    sideToMove = 0;
+    undoCount = 0;
+    startState = saveState();
+    hash = startState.hash;
+    occupancy = startState.occupied[0] | startState.occupied[1];
+
     return true;
 }
 
@@ -108,7 +119,10 @@ GamePiece* Board::makeGamePiece(int row, int col, char tileChar, std::vector<Pla
 
 
 void Board::notify(const Tile& tile) {
-    controller->notify(tile);
+    // Boards used by tools have no controller and nothing to redraw
+    if (controller) {
+        controller->notify(tile);
+    }
 }
 
 
@@ -119,6 +133,24 @@ Tile* Board::getTile(int row, int col) {
     return &board[row][col];
 }
 
+Tile* Board::getLeapDestination(int row, int col, int dir) {
+    int square = GameState::toSquare(row, col);
+    uint64_t blockers = leapTable.crossed[dir][square] & occupancy;
+
+    int distance = blockers ? Bitboard::LeapTable::blockerDistance(dir, square, blockers) : leapTable.distance[dir][square];
+    return &board[row + Constants::DIRECTION_ROW_STEP[dir] * distance][col + Constants::DIRECTION_COL_STEP[dir] * distance];
+}
+
+void Board::setOccupied(int row, int col, bool occupied) {
+    if (row < 1 || row > Constants::PLAYABLE_LENGTH || col < 1 || col > Constants::PLAYABLE_WIDTH) {
+        return;
+    }
+
+    uint64_t bit = GameState::bit(GameState::toSquare(row, col));
+    occupancy = occupied ? (occupancy | bit) : (occupancy & ~bit);
+}
+
+
 int Board::getLength() {
     return length;
 }
@@ -126,3 +158,284 @@ int Board::getLength() {
 int Board::getWidth() {
     return width;
 }
+
+
+uint64_t Board::getHash() const {
+    return hash;
+}
+
+void Board::xorHash(uint64_t key) {
+    hash ^= key;
+}
+
+int Board::getSideToMove() const {
+    return sideToMove;
+}
+
+void Board::switchSideToMove() {
+    sideToMove ^= 1;
+    hash ^= Zobrist::side();
+}
+
+
+int Board::generateLegalMoves(int playerIndex, MoveList& moves) {
+    GameState state = saveState();
+    state.sideToMove = playerIndex;
+    Bitboard::generateMoves(state, moves);
+    return moves.size();
+}
+
+
+void Board::reset() {
+    loadState(startState);
+}
+
+
+Tile& Board::getSquare(int square) {
+    return board[GameState::toRow(square)][GameState::toCol(square)];
+}
+
+
+void Board::updateTerrainMasks() {
+    trapMask = 0;
+    waterMask = 0;
+    denMask[0] = denMask[1] = 0;
+
+    for (int r = 1; r <= Constants::PLAYABLE_LENGTH; r++) {
+        for (int c = 1; c <= Constants::PLAYABLE_WIDTH; c++) {
+            Tile& tile = board[r][c];
+            uint64_t bit = GameState::bit(GameState::toSquare(r, c));
+
+            if (tile.getIsWater()) {
+                waterMask |= bit;
+            }
+
+            TileEffect* effect = tile.getTileEffect();
+            if (effect && effect->isTrap()) {
+                trapMask |= bit;
+            }
+            else if (effect && effect->isGoal()) {
+                denMask[effect->getPlayer()->getIndex()] |= bit;
+            }
+        }
+    }
+
+    leapTable.init(waterMask);
+}
+
+
+GameState Board::saveState() {
+    assert(length == Constants::BOARD_SIZE_2_PLAYER && width == Constants::BOARD_WIDTH_2_PLAYER);
+
+    GameState state{};
+    state.sideToMove = sideToMove;
+    state.winner = -1;
+    state.trapMask = trapMask;
+    state.waterMask = waterMask;
+    state.denMask[0] = denMask[0];
+    state.denMask[1] = denMask[1];
+
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < Constants::NUM_PIECES; i++) {
+            state.pieceSquare[p][i] = -1;
+        }
+        if ((*players)[p].getHasWon()) {
+            state.winner = p;
+        }
+    }
+
+    for (int r = 1; r <= Constants::PLAYABLE_LENGTH; r++) {
+        for (int c = 1; c <= Constants::PLAYABLE_WIDTH; c++) {
+            GamePiece* piece = board[r][c].getPiece();
+            if (piece) {
+                int owner = piece->getOwner()->getIndex();
+                int square = GameState::toSquare(r, c);
+                state.pieceSquare[owner][piece->getPiece() - '1'] = square;
+                state.occupied[owner] |= GameState::bit(square);
+            }
+        }
+    }
+
+    state.hash = Zobrist::hash(state);
+    return state;
+}
+
+
+bool Board::readLayout(const std::string& filename, std::vector<std::string>& layout) {
+    std::ifstream layoutFile{filename};
+    if (!layoutFile) {
+        std::cerr << "Could not read or open file: " << filename << std::endl;
+        return false;
+    }
+
+    layout.clear();
+    std::string line;
+    while (std::getline(layoutFile, line)) {
+        layout.push_back(line);
+    }
+    return true;
+}
+
+bool Board::loadLayout(const std::string& filename, GameState& state) {
+    std::vector<std::string> layout;
+    if (!readLayout(filename, layout)) {
+        return false;
+    }
+
+    std::vector<Player> players;
+    for (int i = 0; i < 2; i++) {
+        players.emplace_back(i, Constants::PLAYER_STARTING_PIECES[i]);
+    }
+
+    // No controller: no views to notify
+    Board board{Constants::BOARD_SIZE_2_PLAYER, Constants::BOARD_WIDTH_2_PLAYER, nullptr};
+    board.init(layout, players);
+    state = board.saveState();
+    return true;
+}
+
+
+Constants::MOVE_RESULT Board::makeMove(const Move& move) {
+    assert(undoCount < Constants::MAX_UNDO_DEPTH);
+
+    int side = sideToMove;
+    uint64_t toBit = GameState::bit(move.to);
+    Tile& fromTile = getSquare(move.from);
+    Tile& toTile = getSquare(move.to);
+    GamePiece* piece = fromTile.getPiece();
+
+    UndoRecord& undo = undoStack[undoCount++];
+    undo.piece = piece;
+    undo.captured = nullptr;
+    undo.from = move.from;
+    undo.to = move.to;
+    undo.wasTrapped = piece->isTrapped();
+    undo.capturedTrapped = false;
+    undo.enteredDen = false;
+    undo.attackerLost = false;
+    undo.hash = hash;
+
+    Constants::MOVE_RESULT result = Constants::MOVE_SUCCESS;
+
+    // Strengths as they are at battle time, the trap on the destination
+    // has already been entered (see MovementSystem::move)
+    int atkStrength = ((trapMask & toBit) || undo.wasTrapped) ? 0 : piece->getStrength();
+
+    fromTile.setPiece(nullptr);
+    hash ^= Zobrist::piece(side, move.piece, move.from);
+    piece->setTrapped(false);
+
+    if (denMask[side] & toBit) {
+        undo.enteredDen = true;
+        piece->setDead(true);
+        piece->setPosition(-1, -1);
+        piece->getOwner()->setHasWon(true);
+        result = Constants::MOVE_KILLED;
+    }
+    else if (GamePiece* other = toTile.getPiece()) {
+        int defStrength = (trapMask & toBit) ? 0 : other->getStrength();
+
+        if (Bitboard::BATTLE.attackerWins[atkStrength][defStrength]) {
+            undo.captured = other;
+            undo.capturedTrapped = other->isTrapped();
+            other->setTrapped(false);
+            other->setDead(true);
+            other->setPosition(-1, -1);
+            toTile.setPiece(nullptr);
+            hash ^= Zobrist::piece(side ^ 1, other->getPieceIndex(), move.to);
+        }
+        else {
+            undo.attackerLost = true;
+            piece->setDead(true);
+            piece->setPosition(-1, -1);
+            result = Constants::MOVE_KILLED;
+        }
+    }
+
+    if (result == Constants::MOVE_SUCCESS) {
+        piece->setPosition(toTile.getRow(), toTile.getColumn());
+        toTile.setPiece(piece);
+        hash ^= Zobrist::piece(side, move.piece, move.to);
+        piece->setTrapped(trapMask & toBit);
+    }
+
+    switchSideToMove();
+    return result;
+}
+
+
+void Board::unmakeMove() {
+    assert(undoCount > 0);
+
+    const UndoRecord& undo = undoStack[--undoCount];
+    Tile& fromTile = getSquare(undo.from);
+    Tile& toTile = getSquare(undo.to);
+    GamePiece* piece = undo.piece;
+
+    if (undo.enteredDen) {
+        piece->getOwner()->setHasWon(false);
+    }
+    else if (!undo.attackerLost) {
+        toTile.setPiece(nullptr);
+    }
+
+    if (undo.captured) {
+        undo.captured->setDead(false);
+        undo.captured->setPosition(toTile.getRow(), toTile.getColumn());
+        undo.captured->setTrapped(undo.capturedTrapped);
+        toTile.setPiece(undo.captured);
+    }
+
+    piece->setDead(false);
+    piece->setPosition(fromTile.getRow(), fromTile.getColumn());
+    piece->setTrapped(undo.wasTrapped);
+    fromTile.setPiece(piece);
+
+    sideToMove ^= 1;
+    hash = undo.hash;
+}
+
+
+void Board::loadState(const GameState& state) {
+    for (int r = 1; r <= Constants::PLAYABLE_LENGTH; r++) {
+        for (int c = 1; c <= Constants::PLAYABLE_WIDTH; c++) {
+            board[r][c].setPiece(nullptr);
+        }
+    }
+
+    for (int p = 0; p < 2; p++) {
+        Player& player = (*players)[p];
+        player.setHasWon(state.winner == p);
+
+        for (int i = 0; i < Constants::NUM_PIECES; i++) {
+            GamePiece* piece = player.pieces[Constants::PLAYER_STARTING_PIECES[p] + i].get();
+            if (!piece) continue;
+
+            int square = state.pieceSquare[p][i];
+            if (square < 0) {
+                piece->setPosition(-1, -1);
+                piece->setDead(true);
+                piece->setTrapped(false);
+                continue;
+            }
+
+            int row = GameState::toRow(square);
+            int col = GameState::toCol(square);
+            piece->setPosition(row, col);
+            piece->setDead(false);
+            piece->setTrapped(state.isTrap(square));
+            board[row][col].setPiece(piece);
+        }
+    }
+
+    sideToMove = state.sideToMove;
+    hash = state.hash;
+    undoCount = 0;
+
+    // Views only learn about the new position through tile notifications
+    for (int r = 1; r <= Constants::PLAYABLE_LENGTH; r++) {
+        for (int c = 1; c <= Constants::PLAYABLE_WIDTH; c++) {
+            board[r][c].notify();
+        }
+    }
+}
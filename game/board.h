@@ -1,20 +1,57 @@
 #ifndef __BOARD_H__
 #define __BOARD_H__
 
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <string>
+#include "bitboard.h"
+#include "constants.h"
+#include "gamestate.h"
+#include "move.h"
 #include "tile.h"
 
 class Controller;
 class Player;
 class GamePiece;
 
+// Everything Board::unmakeMove needs to take a move back
+struct UndoRecord {
+    GamePiece* piece;
+    GamePiece* captured;  // defender removed by the move, if any
+    int8_t from;
+    int8_t to;
+    bool wasTrapped;
+    bool capturedTrapped;
+    bool enteredDen;
+    bool attackerLost;
+    uint64_t hash;        // key before the move
+};
+
 class Board {
     std::vector<std::vector<Tile>> board;
     int length; // length of the board side length including walls
     int width; // width of the board
     Controller* controller;
+    std::vector<Player>* players; // set by init
+    uint64_t hash;   // Zobrist key of the current position
+    int sideToMove;
+
+    // Terrain as GameState masks, fixed once init has run
+    uint64_t trapMask;
+    uint64_t waterMask;
+    uint64_t denMask[2];
+    Bitboard::LeapTable leapTable;
+
+    uint64_t occupancy; // squares with a piece on them, kept by Tile::setPiece
+
+    GameState startState; // position right after init, for reset
+
+    UndoRecord undoStack[Constants::MAX_UNDO_DEPTH];
+    int undoCount;
+
+    Tile& getSquare(int square);
+    void updateTerrainMasks();
 
     // Helper function to get which player index a char belongs to 
     int getPlayer(char t);
@@ -27,6 +64,44 @@ class Board {
         int getLength();
         int getWidth();
         void notify(const Tile& tile);
+
+        // Landing tile of a tiger/lion leap from (row, col) in direction dir
+        // (index into Constants::DIRECTIONS). A piece in the water stops
+        // the leap on its tile.
+        Tile* getLeapDestination(int row, int col, int dir);
+        void setOccupied(int row, int col, bool occupied);
+
+        // Position key, updated incrementally as pieces enter and leave tiles
+        uint64_t getHash() const;
+        void xorHash(uint64_t key);
+        int getSideToMove() const;
+        void switchSideToMove();
+
+        // Writes only the moves playerIndex can actually make into moves,
+        // returns how many there are
+        int generateLegalMoves(int playerIndex, MoveList& moves);
+
+        // Plays a legal move for the side to move straight on the tiles: no
+        // tile effects, no view notifications and no allocation. Every
+        // makeMove must be paired with an unmakeMove in reverse order.
+        Constants::MOVE_RESULT makeMove(const Move& move);
+        void unmakeMove();
+
+        // Back to the position init set up, without touching the layout file
+        // or allocating: pieces are revived and moved back onto their tiles
+        void reset();
+
+        // Flat snapshot of the live position, and the reverse
+        GameState saveState();
+        void loadState(const GameState& state);
+
+        // Lines of a board.txt style layout file, false (with a message on
+        // std::cerr) if it can't be read
+        static bool readLayout(const std::string& filename, std::vector<std::string>& layout);
+        // Start position of a 2 player layout file, for tools that only need
+        // the GameState and no live board
+        static bool loadLayout(const std::string& filename, GameState& state);
+
         Board(int length, int width, Controller* controller);
 };
 
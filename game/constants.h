@@ -12,6 +12,21 @@ namespace Constants {
     constexpr int NUM_PIECES = 8;
     constexpr int NUM_ABILITIES = 5;
 
+    // playable area inside the wall border, one square per tile
+    constexpr int PLAYABLE_LENGTH = BOARD_SIZE_2_PLAYER - 2;
+    constexpr int PLAYABLE_WIDTH = BOARD_WIDTH_2_PLAYER - 2;
+    constexpr int NUM_SQUARES = PLAYABLE_LENGTH * PLAYABLE_WIDTH;
+
+    // direction order matches the AI action encoding (piece * 4 + dir)
+    constexpr int NUM_DIRECTIONS = 4;
+    constexpr char DIRECTIONS[NUM_DIRECTIONS] = {'N', 'S', 'E', 'W'};
+    constexpr int DIRECTION_ROW_STEP[NUM_DIRECTIONS] = {-1, 1, 0, 0};
+    constexpr int DIRECTION_COL_STEP[NUM_DIRECTIONS] = {0, 0, 1, -1};
+    constexpr int MAX_MOVES = NUM_PIECES * NUM_DIRECTIONS;
+
+    // deepest line Board::makeMove can take back
+    constexpr int MAX_UNDO_DEPTH = 256;
+
     enum MOVE_RESULT {
         MOVE_SUCCESS,
         MOVE_INVALID,
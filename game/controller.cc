@@ -24,8 +24,10 @@ Controller::Controller(
     bool useGraphics,
     bool viewPerPlayer,
     bool POVEnabled,
-    bool aiTraining
-) : currentPlayer{0}, useGraphics{useGraphics}, viewPerPlayer{viewPerPlayer}, POVEnabled{POVEnabled}, aiTraining{aiTraining}
+    bool aiTraining,
+    bool headless
+) : currentPlayer{0}, useGraphics{useGraphics && !headless}, viewPerPlayer{viewPerPlayer}, POVEnabled{POVEnabled},
+    aiTraining{aiTraining}, headless{headless}
 {
     // Initialize training visualizer if in training mode
     if (aiTraining) {
@@ -46,9 +48,11 @@ Controller::Controller(
     int boardWidth = Constants::BOARD_WIDTH_2_PLAYER;
 
 
-    // Initialize text and optionally graphical views
-    tv = std::make_unique<TextView>(boardLength, boardWidth, players);
-    if (useGraphics) {
+    // Initialize text and optionally graphical views, headless runs have none
+    if (!headless) {
+        tv = std::make_unique<TextView>(boardLength, boardWidth, players);
+    }
+    if (this->useGraphics) {
         if (viewPerPlayer) {
             for (int i = 0; i < numPlayers; i++) {
                 graphicalViews.push_back(
@@ -74,15 +78,17 @@ Controller::Controller(
     }
 
     // Initialize the board with specified layout, makes links and tiles
-    board = std::make_unique<Board>(boardLength, boardWidth, this);
+    board = std::make_unique<Board>(boardLength, boardWidth, headless ? nullptr : this);
     bool initSuccess = board->init(layout, players);
 
     // Board must be initialized successfully
     assert(initSuccess);
 
     // Initial display
-    tv->printStartTurn(std::cout, currentPlayer);
-    tv->print(std::cout, 0, POVEnabled);
+    if (tv) {
+        tv->printStartTurn(std::cout, currentPlayer);
+        tv->print(std::cout, 0, POVEnabled);
+    }
 
     for (int i = 0; i < graphicalViews.size(); i++) {
         if (!graphicalViews[i]) {
@@ -105,8 +111,20 @@ bool Controller::nextTurn() {
         return false;
     }
 
+    int mover = currentPlayer;
     currentPlayer = (currentPlayer + 1) % players.size();
 
+    // A player left without a legal move loses, as in GameState
+    MoveList legalMoves;
+    if (board->generateLegalMoves(currentPlayer, legalMoves) == 0) {
+        if (!aiTraining) {
+            std::cout << "Player " << (currentPlayer + 1) << " has no legal moves!" << std::endl;
+        }
+        players[mover].setHasWon(true);
+        gameOver();
+        return false;
+    }
+
     if (tv && !aiTraining) {
         tv->printStartTurn(std::cout, currentPlayer);
         tv->print(std::cout, currentPlayer, POVEnabled);
@@ -138,8 +156,14 @@ void Controller::play() {
 
         // Check if current player is AI
         if (isAIPlayer(currentPlayer)) {
+            int mover = currentPlayer;
             handleAITurn();
             if (!nextTurn()) break;
+
+            // The AI can think while the human does
+            if (!isAIPlayer(currentPlayer)) {
+                aiPlayers[mover]->startPondering(board.get());
+            }
             continue;
         }
 
@@ -239,9 +263,11 @@ void Controller::play() {
             Constants::MOVE_RESULT result = players[currentPlayer].move(board.get(), pieceName, cardinalDir);
 
             if (result == Constants::MOVE_SUCCESS || result == Constants::MOVE_KILLED) {
-                tv->print(std::cout, currentPlayer, POVEnabled);
+                if (tv) {
+                    tv->print(std::cout, currentPlayer, POVEnabled);
+                }
                 bool result = nextTurn();
-                if (!result) return;
+                if (!result) break;
                 continue;
             }
 
@@ -264,6 +290,13 @@ void Controller::play() {
         }
 
     }
+
+    // No more moves to think about
+    for (auto& aiPlayer : aiPlayers) {
+        if (aiPlayer) {
+            aiPlayer->stopPondering();
+        }
+    }
 }
 
 bool Controller::gameOver() {
@@ -316,20 +349,49 @@ void Controller::convertCoordinatesPOV(int& row, int& col, int POVindex) {
 }
 
 void Controller::setAIPlayer(int playerIndex, double learningRate) {
+    // Create AI player with same starting piece as regular player
+    char startingPiece = Constants::PLAYER_STARTING_PIECES[playerIndex];
+    setAIPlayer(playerIndex, std::make_unique<AIPlayer>(playerIndex, startingPiece, learningRate));
+}
+
+void Controller::setAIPlayer(int playerIndex, std::unique_ptr<Player> player) {
     if (playerIndex >= 0 && playerIndex < players.size()) {
         // Ensure we have enough AI player slots
         while (aiPlayers.size() <= playerIndex) {
             aiPlayers.push_back(nullptr);
         }
         
-        // Create AI player with same starting piece as regular player
-        char startingPiece = Constants::PLAYER_STARTING_PIECES[playerIndex];
-        aiPlayers[playerIndex] = std::make_unique<AIPlayer>(playerIndex, startingPiece, learningRate);
+        aiPlayers[playerIndex] = std::move(player);
         
         std::cout << "Player " << (playerIndex + 1) << " set as AI" << std::endl;
     }
 }
 
+AIPlayer* Controller::getLearner(int playerIndex) {
+    if (!isAIPlayer(playerIndex)) {
+        return nullptr;
+    }
+    return dynamic_cast<AIPlayer*>(aiPlayers[playerIndex].get());
+}
+
+bool Controller::recordGames(const std::string& filename) {
+    gameRecord = std::make_unique<std::ofstream>(filename, std::ios::app);
+    if (!*gameRecord) {
+        std::cerr << "Error: Could not open " << filename << " for game records" << std::endl;
+        gameRecord.reset();
+        return false;
+    }
+    return true;
+}
+
+void Controller::writeGameRecord(int winner) {
+    *gameRecord << winner;
+    for (const Move& move : recordedMoves) {
+        *gameRecord << ' ' << move.getPieceId() << move.getDirection();
+    }
+    *gameRecord << '\n';
+}
+
 bool Controller::isAIPlayer(int playerIndex) const {
     return playerIndex < aiPlayers.size() && aiPlayers[playerIndex] != nullptr;
 }
@@ -338,61 +400,44 @@ bool Controller::handleAITurn() {
     if (!isAIPlayer(currentPlayer)) {
         return false;  // Not an AI player
     }
-    
-    // Try multiple moves until we find a valid one
-    const int maxAttempts = 50;  // Prevent infinite loops
-    int attempts = 0;
-    
-    while (attempts < maxAttempts) {
-        // Get AI move
-        auto move = aiPlayers[currentPlayer]->chooseMove(board.get());
-        char pieceId = move.first;
-        char direction = move.second;
-        
-        // Execute the move
-        Constants::MOVE_RESULT result = players[currentPlayer].move(board.get(), pieceId, direction);
-        
+
+    MoveList legalMoves;
+    if (board->generateLegalMoves(currentPlayer, legalMoves) == 0) {
+        if (!aiTraining) {
+            std::cout << "AI Player " << (currentPlayer + 1) << " has no legal moves!" << std::endl;
+        }
+        return true;  // Still handled, nothing to play
+    }
+
+    // The AI only picks from legal moves, so this always succeeds
+    Move move = aiPlayers[currentPlayer]->chooseMove(board.get(), legalMoves);
+    char pieceId = move.getPieceId();
+    char direction = move.getDirection();
+
+    Constants::MOVE_RESULT result = players[currentPlayer].move(board.get(), pieceId, direction);
+    assert(result == Constants::MOVE_SUCCESS || result == Constants::MOVE_KILLED);
+
+    if (gameRecord) {
+        recordedMoves.push_back(move);
+    }
+
+    AIPlayer* learner = getLearner(currentPlayer);
+    if (aiTraining && learner) {
         // Calculate reward for AI learning
         bool gameWon = players[currentPlayer].getHasWon();
         bool gameLost = gameOver() && !gameWon;
-        
-        if (aiTraining) {
-            // Only store experience and add rewards for valid moves
-            if (result == Constants::MOVE_SUCCESS || result == Constants::MOVE_KILLED) {
-                // Store experience for AI learning
-                std::vector<float> currentState = aiPlayers[currentPlayer]->boardToStateVector(board.get());
-                int actionIndex = aiPlayers[currentPlayer]->actionToIndex(pieceId, direction);
-                float reward = aiPlayers[currentPlayer]->calculateReward(result, gameWon, gameLost, board.get(), pieceId);
-                
-                // Add reward to the AI player's total for this game
-                aiPlayers[currentPlayer]->addReward(reward);
-            }
-            // Invalid moves are simply ignored - no negative reinforcement
-        }
-        
-        if (result == Constants::MOVE_SUCCESS || result == Constants::MOVE_KILLED) {
-            if (!aiTraining) {
-                tv->print(std::cout, currentPlayer, POVEnabled);
-                std::cout << "AI Player " << (currentPlayer + 1) << " moved piece " 
-                          << pieceId << " " << direction << std::endl;
-            }
-            return true;  // Valid move made
-        } else {
-            // Invalid move, try again
-            attempts++;
-            if (!aiTraining && attempts <= 3) {  // Only show first few invalid attempts
-                std::cout << "AI Player " << (currentPlayer + 1) << " made invalid move: " 
-                          << pieceId << " " << direction << " (attempt " << attempts << ")" << std::endl;
-            }
-        }
+        float reward = learner->calculateReward(result, gameWon, gameLost, board.get(), pieceId);
+
+        // Add reward to the AI player's total for this game
+        learner->addReward(reward);
     }
-    
-    // If we get here, AI couldn't find a valid move after many attempts
-    if (!aiTraining) {
-        std::cout << "AI Player " << (currentPlayer + 1) << " failed to find valid move after " 
-                  << maxAttempts << " attempts!" << std::endl;
+    else if (!aiTraining && tv) {
+        tv->print(std::cout, currentPlayer, POVEnabled);
+        std::cout << "AI Player " << (currentPlayer + 1) << " moved piece "
+                  << pieceId << " " << direction << std::endl;
     }
-    return true;  // Still handled, but no valid move found
+
+    return true;
 }
 
 void Controller::trainAI(int numGames) {
@@ -404,50 +449,28 @@ void Controller::trainAI(int numGames) {
     std::cout << "Starting AI training with visualization..." << std::endl;
     
     // Set training mode for all AI players to suppress debug output
-    for (auto& aiPlayer : aiPlayers) {
-        if (aiPlayer) {
+    for (int i = 0; i < aiPlayers.size(); ++i) {
+        if (AIPlayer* aiPlayer = getLearner(i)) {
             aiPlayer->setTrainingMode(true);
         }
     }
     
     for (int game = 0; game < numGames; ++game) {
-        // Reset the game for each training iteration
+        // Reset the game for each training iteration, from the layout
+        // the board already parsed
         currentPlayer = 0;
-        
-        // Re-initialize the board and players for each game
-        std::string boardLayoutFile = Constants::BOARD_2_PLAYER;
-        std::ifstream layoutFile{boardLayoutFile};
-        std::vector<std::string> layout;
-        std::string line;
-        while (std::getline(layoutFile, line)) {
-            layout.push_back(line);
-        }
-        layoutFile.close();
-        
-        // Reset players (just reset win state, pieces will be recreated by board init)
-        for (auto& player : players) {
-            player.setHasWon(false);
-        }
-        
-        // Re-create the board
-        int boardLength = Constants::BOARD_SIZE_2_PLAYER;
-        int boardWidth = Constants::BOARD_WIDTH_2_PLAYER;
-        board = std::make_unique<Board>(boardLength, boardWidth, this);
-        bool initSuccess = board->init(layout, players);
-        if (!initSuccess) {
-            std::cerr << "Failed to initialize board for game " << (game + 1) << std::endl;
-            continue;
-        }
+        board->reset();
         
         // Reset AI rewards for this game
-        for (auto& aiPlayer : aiPlayers) {
-            if (aiPlayer) {
+        for (int i = 0; i < aiPlayers.size(); ++i) {
+            if (AIPlayer* aiPlayer = getLearner(i)) {
                 aiPlayer->resetGameReward();
             }
         }
         
         int moves = 0;
         int winner = -1;  // -1 = draw, 0 = player 1, 1 = player 2
+        recordedMoves.clear();
         
         while (moves < 500) {  // Allow longer games for AI learning
             if (isAIPlayer(currentPlayer)) {
@@ -472,24 +495,28 @@ void Controller::trainAI(int numGames) {
             // Game ended due to move limit - it's a draw
             winner = -1;
         }
+
+        if (gameRecord) {
+            writeGameRecord(winner);
+        }
         
         // Record game rewards for each AI player
-        for (auto& aiPlayer : aiPlayers) {
-            if (aiPlayer) {
+        for (int i = 0; i < aiPlayers.size(); ++i) {
+            if (AIPlayer* aiPlayer = getLearner(i)) {
                 aiPlayer->recordGameReward();
             }
         }
         
         // Add data to visualizer
-        if (visualizer && aiPlayers.size() >= 2 && aiPlayers[0] && aiPlayers[1]) {
-            double p1Reward = aiPlayers[0]->getLastGameReward();
-            double p2Reward = aiPlayers[1]->getLastGameReward();
+        if (visualizer && getLearner(0) && getLearner(1)) {
+            double p1Reward = getLearner(0)->getLastGameReward();
+            double p2Reward = getLearner(1)->getLastGameReward();
             visualizer->addGameResult(game + 1, p1Reward, p2Reward, winner);
         }
         
         // Train the AI players after each game
-        for (auto& aiPlayer : aiPlayers) {
-            if (aiPlayer) {
+        for (int i = 0; i < aiPlayers.size(); ++i) {
+            if (AIPlayer* aiPlayer = getLearner(i)) {
                 aiPlayer->trainOnBatch();
                 aiPlayer->decayEpsilon();  // Reduce exploration over time
             }
@@ -512,9 +539,9 @@ void Controller::trainAI(int numGames) {
             
             // Save progress
             for (int i = 0; i < aiPlayers.size(); ++i) {
-                if (aiPlayers[i]) {
+                if (AIPlayer* aiPlayer = getLearner(i)) {
                     std::string filename = "ai_player_" + std::to_string(i) + ".model";
-                    aiPlayers[i]->saveModel(filename);
+                    aiPlayer->saveModel(filename);
                 }
             }
         }
@@ -522,9 +549,9 @@ void Controller::trainAI(int numGames) {
         // Show quick progress for smaller intervals
         if ((game + 1) % 25 == 0 && (game + 1) % 100 != 0) {
             std::cout << "Progress: " << (game + 1) << "/" << numGames << " games";
-            if (visualizer && aiPlayers.size() >= 2 && aiPlayers[0] && aiPlayers[1]) {
-                std::cout << " | Recent rewards: P1=" << aiPlayers[0]->getLastGameReward() 
-                         << ", P2=" << aiPlayers[1]->getLastGameReward();
+            if (visualizer && getLearner(0) && getLearner(1)) {
+                std::cout << " | Recent rewards: P1=" << getLearner(0)->getLastGameReward() 
+                         << ", P2=" << getLearner(1)->getLastGameReward();
             }
             std::cout << std::endl;
         }
@@ -544,20 +571,20 @@ void Controller::trainAI(int numGames) {
     
     // Final save
     for (int i = 0; i < aiPlayers.size(); ++i) {
-        if (aiPlayers[i]) {
+        if (AIPlayer* aiPlayer = getLearner(i)) {
             std::string filename = "ai_player_" + std::to_string(i) + "_final.model";
-            aiPlayers[i]->saveModel(filename);
+            aiPlayer->saveModel(filename);
             // Disable training mode after training completes
-            aiPlayers[i]->setTrainingMode(false);
+            aiPlayer->setTrainingMode(false);
         }
     }
 }
 
 void Controller::playAgainstAI() {
     // Load trained AI model (Player 1 - index 0, the better performer)
-    if (aiPlayers.size() > 0 && aiPlayers[0]) {
-        aiPlayers[0]->loadModel("ai_player_0_final.model");
-        aiPlayers[0]->setEpsilon(0.05);  // Low exploration for playing
+    if (AIPlayer* aiPlayer = getLearner(0)) {
+        aiPlayer->loadModel("ai_player_0_final.model");
+        aiPlayer->setEpsilon(0.05);  // Low exploration for playing
     }
     
     // Normal game loop with AI handling
@@ -8,6 +8,7 @@
 #include "../ai/aiplayer.h"
 #include "../ai/training_visualizer.h"
 
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -25,16 +26,24 @@ class Controller {
     bool viewPerPlayer;
     bool POVEnabled;
     bool aiTraining;  // Flag for AI training mode
+    bool headless;    // No views at all, the board reports to nobody
 
     std::stack<std::unique_ptr<std::istream>> inputStack;
-    std::vector<std::unique_ptr<AIPlayer>> aiPlayers;  // AI players
+    std::vector<std::unique_ptr<Player>> aiPlayers;    // Computer players, by player index
     std::unique_ptr<TrainingVisualizer> visualizer;    // Training visualization
 
+    // Training games, one line each: the winner (0, 1, or -1 for no
+    // result) then every move as piece and direction, e.g. "0 4S 1N 4S"
+    std::unique_ptr<std::ofstream> gameRecord;
+    std::vector<Move> recordedMoves;
+
     bool gameOver();
     bool nextTurn();
     bool handleAITurn();  // Handle AI player turn
+    AIPlayer* getLearner(int playerIndex);  // The DQN player at playerIndex, if that's what it is
     
     void announceWinner(int playerIndex);
+    void writeGameRecord(int winner);
 
     void convertCoordinatesPOV(int& row, int& col, int POVindex);
 
@@ -48,12 +57,17 @@ class Controller {
             bool useGraphics,
             bool viewPerPlayer,
             bool POVEnabled,
-            bool aiTraining = false
+            bool aiTraining = false,
+            bool headless = false
         );
 
         void notify(const Tile& tile);
         void setAIPlayer(int playerIndex, double learningRate = 0.001);
+        // Any computer player, e.g. a SearchPlayer
+        void setAIPlayer(int playerIndex, std::unique_ptr<Player> player);
         bool isAIPlayer(int playerIndex) const;
+        // Appends every training game to filename, for tools/bookgen
+        bool recordGames(const std::string& filename);
 };
 
 #endif
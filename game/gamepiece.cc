@@ -2,10 +2,13 @@
 
 #include "link.h"
 #include "movementsystem.h"
+#include "movepolicy.h"
 #include "normalmove.h"
 #include "watermove.h"
 #include "leapmove.h"
 #include "player.h"
+#include "board.h"
+#include "zobrist.h"
 
 #include <memory>
 
@@ -43,6 +46,7 @@ bool GamePiece::remove() {
         return false;
     }
 
+    // leaveTile also takes the piece out of the board's hash
     movementSystem->leaveTile();
     dead = true;
 
@@ -53,6 +57,10 @@ bool GamePiece::isDead() {
     return dead;
 }
 
+void GamePiece::setDead(bool state) {
+    dead = state;
+}
+
 bool GamePiece::isTrapped() {
     return trapped;
 }
@@ -66,6 +74,9 @@ void GamePiece::setInWater(bool state) {
 }
 
 void GamePiece::setTrapped(bool state) {
+    if (trapped != state) {
+        board->xorHash(Zobrist::trapped(owner->getIndex(), getPieceIndex()));
+    }
     trapped = state;
 }
 
@@ -77,6 +88,10 @@ char GamePiece::getPiece() {
     return piece;
 }
 
+int GamePiece::getPieceIndex() {
+    return piece - Constants::PLAYER_STARTING_PIECES[owner->getIndex()];
+}
+
 Board* GamePiece::getBoard() {
     return board;
 }
@@ -89,6 +104,16 @@ MovementSystem* GamePiece::getMovementSystem() {
     return movementSystem.get();
 }
 
+Constants::MOVE_RESULT GamePiece::move(Board& board, char dir) {
+    // A built-in kind pins down the exact rules, anything else is Custom
+    switch (movementSystem->getKind()) {
+        case MoveKind::Normal: return movementSystem->moveAs<MoveKind::Normal>(board, dir);
+        case MoveKind::Water: return movementSystem->moveAs<MoveKind::Water>(board, dir);
+        case MoveKind::Leap: return movementSystem->moveAs<MoveKind::Leap>(board, dir);
+        default: return movementSystem->move(board, dir);
+    }
+}
+
 void GamePiece::setMovementSystem(std::unique_ptr<MovementSystem> movementSystem) {
     this->movementSystem = std::move(movementSystem);
 }
@@ -1,6 +1,7 @@
 #ifndef __GAMEPIECE_H__
 #define __GAMEPIECE_H__
 
+#include "constants.h"
 #include "link.h"
 #include "movementsystem.h"
 
@@ -33,6 +34,7 @@ class GamePiece {
         bool remove();
         
         bool isDead();
+        void setDead(bool state);
         bool isInWater();
         void setInWater(bool state);
         bool isTrapped();
@@ -40,11 +42,15 @@ class GamePiece {
 
         int getStrength();
         char getPiece();
+        int getPieceIndex(); // 0-7, index into the owner's pieces
         Board* getBoard();
 
         Player* getOwner();
 
         MovementSystem* getMovementSystem();
+
+        // Moves through the movement system, built-in kinds skip the vtable
+        Constants::MOVE_RESULT move(Board& board, char dir);
         
         // Pass in new movementSystem*, owns-a
         void setMovementSystem(std::unique_ptr<MovementSystem> movementSystem);
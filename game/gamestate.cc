@@ -0,0 +1,172 @@
+#include "gamestate.h"
+
+#include "bitboard.h"
+#include "constants.h"
+#include "move.h"
+#include "zobrist.h"
+
+#include <type_traits>
+
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must stay memcpy-able");
+static_assert(Constants::NUM_SQUARES <= 64, "playable area must fit in a 64 bit mask");
+
+
+namespace {
+    // tiger and lion leap across water (see GamePiece::GamePiece)
+    bool canLeap(int piece) {
+        return piece == 5 || piece == 6;
+    }
+}
+
+
+int GameState::pieceAt(int square, int& owner) const {
+    uint64_t mask = bit(square);
+    for (int p = 0; p < 2; p++) {
+        if (!(occupied[p] & mask)) continue;
+
+        for (int i = 0; i < Constants::NUM_PIECES; i++) {
+            if (pieceSquare[p][i] == square) {
+                owner = p;
+                return i;
+            }
+        }
+    }
+    owner = -1;
+    return -1;
+}
+
+
+int GameState::getStrength(int player, int piece) const {
+    int square = pieceSquare[player][piece];
+    if (square < 0) return 0;
+    return isTrap(square) ? 0 : piece + 1;
+}
+
+
+Constants::MOVE_RESULT GameState::resolve(int piece, int dir, Move& move) const {
+    int side = sideToMove;
+    int from = pieceSquare[side][piece];
+
+    if (from < 0 || isGameOver()) {
+        return Constants::MOVE_INVALID;
+    }
+
+    uint64_t target = Bitboard::STEPS.step[dir][from];
+
+    // Leap over water to land, a piece in the way (a rat) stops it on its square
+    if (canLeap(piece) && (target & waterMask)) {
+        const Bitboard::LeapTable& leap = Bitboard::leapTable(waterMask);
+        uint64_t blockers = leap.crossed[dir][from] & (occupied[0] | occupied[1]);
+        target = blockers ? bit(Bitboard::LeapTable::firstBlocker(dir, blockers)) : leap.landing[dir][from];
+    }
+
+    if (!target) {
+        return Constants::MOVE_WALL;
+    }
+
+    int to = Bitboard::lsb(target);
+    move.piece = piece;
+    move.dir = dir;
+    move.from = from;
+    move.to = to;
+
+    // Reaching the opponent's den wins, our own den acts as a wall
+    if (denMask[side] & target) {
+        return Constants::MOVE_KILLED;
+    }
+    if ((denMask[side ^ 1] & target)) {
+        return Constants::MOVE_WALL;
+    }
+
+    if (occupied[side] & target) {
+        return Constants::MOVE_OWNPIECE;
+    }
+
+    if ((waterMask & target) && piece != 0) {
+        return Constants::MOVE_WATER_INVALID;
+    }
+
+    if (!(occupied[side ^ 1] & target)) {
+        return Constants::MOVE_SUCCESS;
+    }
+
+    // Trap effects apply on entry, before the battle
+    int owner;
+    int other = pieceAt(to, owner);
+    int atkStrength = (isTrap(to) || isTrap(from)) ? 0 : piece + 1;
+    int defStrength = isTrap(to) ? 0 : other + 1;
+
+    if (isWater(from) != isWater(to) && (atkStrength == 1 || defStrength == 1)) {
+        return Constants::MOVE_RAT_INVALID;
+    }
+
+    return Bitboard::BATTLE.attackerWins[atkStrength][defStrength] ? Constants::MOVE_SUCCESS : Constants::MOVE_KILLED;
+}
+
+
+Constants::MOVE_RESULT GameState::play(int piece, int dir) {
+    Move move;
+    Constants::MOVE_RESULT result = resolve(piece, dir, move);
+    if (result != Constants::MOVE_SUCCESS && result != Constants::MOVE_KILLED) {
+        return result;
+    }
+    return play(move);
+}
+
+
+// move must come from resolve/generateMoves for this position
+Constants::MOVE_RESULT GameState::play(const Move& move) {
+    int side = sideToMove;
+    int enemy = side ^ 1;
+    uint64_t fromBit = bit(move.from);
+    uint64_t toBit = bit(move.to);
+
+    sideToMove ^= 1;
+    hash ^= Zobrist::side();
+
+    occupied[side] &= ~fromBit;
+    hash ^= Zobrist::piece(side, move.piece, move.from);
+    if (trapMask & fromBit) {
+        hash ^= Zobrist::trapped(side, move.piece);
+    }
+
+    if (denMask[side] & toBit) {
+        pieceSquare[side][move.piece] = -1;
+        winner = side;
+        return Constants::MOVE_KILLED;
+    }
+
+    if (occupied[enemy] & toBit) {
+        int owner;
+        int other = pieceAt(move.to, owner);
+        int atkStrength = (isTrap(move.to) || isTrap(move.from)) ? 0 : move.piece + 1;
+        int defStrength = isTrap(move.to) ? 0 : other + 1;
+
+        if (!Bitboard::BATTLE.attackerWins[atkStrength][defStrength]) {
+            pieceSquare[side][move.piece] = -1;
+            return Constants::MOVE_KILLED;
+        }
+
+        pieceSquare[enemy][other] = -1;
+        occupied[enemy] &= ~toBit;
+        hash ^= Zobrist::piece(enemy, other, move.to);
+        if (trapMask & toBit) {
+            hash ^= Zobrist::trapped(enemy, other);
+        }
+    }
+
+    pieceSquare[side][move.piece] = move.to;
+    occupied[side] |= toBit;
+    hash ^= Zobrist::piece(side, move.piece, move.to);
+    if (trapMask & toBit) {
+        hash ^= Zobrist::trapped(side, move.piece);
+    }
+
+    return Constants::MOVE_SUCCESS;
+}
+
+
+void GameState::generateMoves(MoveList& moves) const {
+    Bitboard::generateMoves(*this, moves);
+}
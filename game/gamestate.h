@@ -0,0 +1,59 @@
+#ifndef __GAMESTATE_H__
+#define __GAMESTATE_H__
+
+#include "constants.h"
+#include "move.h"
+
+#include <cstdint>
+
+
+// Flat, trivially-copyable snapshot of a 2 player position, so search and
+// self-play can clone positions with a plain copy instead of rebuilding the
+// Board/Tile/GamePiece graph.
+//
+// Squares index the playable area inside the wall border:
+//     square = (row - 1) * PLAYABLE_WIDTH + (col - 1)
+// A piece standing on a trap square is trapped (strength 0), matching
+// TrapEffect::onEnter/onLeave.
+struct GameState {
+    int8_t pieceSquare[2][Constants::NUM_PIECES]; // -1 once the piece is gone
+    uint64_t occupied[2];
+    uint64_t trapMask;
+    uint64_t waterMask;
+    uint64_t denMask[2]; // den each player is trying to reach
+    uint64_t hash;       // Zobrist key, kept up to date by play
+    uint8_t sideToMove;
+    int8_t winner;       // -1 while the game is in progress
+
+    static int toSquare(int row, int col) {
+        return (row - 1) * Constants::PLAYABLE_WIDTH + (col - 1);
+    }
+    static int toRow(int square) { return square / Constants::PLAYABLE_WIDTH + 1; }
+    static int toCol(int square) { return square % Constants::PLAYABLE_WIDTH + 1; }
+    static uint64_t bit(int square) { return uint64_t(1) << square; }
+
+    bool isWater(int square) const { return waterMask & bit(square); }
+    bool isTrap(int square) const { return trapMask & bit(square); }
+    bool isGameOver() const { return winner >= 0; }
+
+    // Returns the piece index on square (and its owner), or -1 if empty
+    int pieceAt(int square, int& owner) const;
+    int getStrength(int player, int piece) const;
+
+    // Works out where piece would go in direction dir and whether the
+    // move is allowed, without changing the state. Mirrors MovementSystem::move.
+    Constants::MOVE_RESULT resolve(int piece, int dir, Move& move) const;
+
+    // Applies a move for the side to move, returns MOVE_SUCCESS or
+    // MOVE_KILLED (attacker lost the battle or entered the den) on success
+    Constants::MOVE_RESULT play(int piece, int dir);
+    Constants::MOVE_RESULT play(const Move& move);
+
+    // Fills moves with every move the side to move can legally make,
+    // uses the bitboard generator. A side with no legal moves (every piece
+    // captured or boxed in) has lost; the search, MCTS and tablebases score
+    // it that way and Controller::nextTurn ends the game there.
+    void generateMoves(MoveList& moves) const;
+};
+
+#endif
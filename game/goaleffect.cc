@@ -2,7 +2,7 @@
 #include "gamepiece.h"
 #include "player.h"
 
-GoalEffect::GoalEffect(Player* player) : TileEffect(player) {}
+GoalEffect::GoalEffect(Player* player, EffectKind kind) : TileEffect(player, kind) {}
 
 
 void GoalEffect::onEnter(GamePiece* piece) {
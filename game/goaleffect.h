@@ -6,8 +6,14 @@
 class GamePiece;
 
 class GoalEffect : public TileEffect {
+    protected:
+        // Subclasses that override anything pass EffectKind::Custom
+        GoalEffect(Player* player, EffectKind kind);
+
     public:
-        GoalEffect(Player* player);
+        // Tagged EffectKind::Goal, which runs the built-in code and skips any overrides.
+        // Subclasses that override must use the EffectKind::Custom constructor
+        GoalEffect(Player* player) : GoalEffect(player, EffectKind::Goal) {}
         void onEnter(GamePiece* piece) override;
         bool isGoal() const override;
 };
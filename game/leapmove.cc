@@ -5,36 +5,20 @@
 #include "tileeffect.h"
 #include "gamepiece.h"
 
-LeapMove::LeapMove(GamePiece* piece) : MovementSystem(piece) {}
+LeapMove::LeapMove(GamePiece* piece, MoveKind kind) : MovementSystem(piece, kind) {}
 
 Tile* LeapMove::getDestinationTile(Board& board, char dir) {
-    int speed = 1;
-    int n = board.getLength();
-    int m = board.getWidth();
-
-    int row = piece->getRow();
-    int col = piece->getCol();
-
-    int horizontal = 0;
-    int vertical = 0;
+    int index;
     switch (std::toupper(dir)) {
-        case 'N': vertical = -1; break;
-        case 'S': vertical = 1; break;
-        case 'W': horizontal = -1; break;
-        case 'E': horizontal = 1; break;
+        case 'N': index = 0; break;
+        case 'S': index = 1; break;
+        case 'E': index = 2; break;
+        case 'W': index = 3; break;
         default:
             // Invalid input (shouldn't happen)
             return nullptr;
     }
 
-    row += vertical;
-    col += horizontal;
-    // check if water then leaping activates, also check if there is a rat or any piece in general
-    while (board.getTile(row, col)->getIsWater() && !board.getTile(row, col)->getPiece()) {
-        row += vertical;
-        col += horizontal;
-    }
-
-    // Shouldn't ever be out of bounds since there is phasing
-    return board.getTile(row, col);
+    // Precomputed jump over the river, a rat in the water blocks it
+    return board.getLeapDestination(piece->getRow(), piece->getCol(), index);
 }
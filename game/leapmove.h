@@ -10,8 +10,14 @@ class Tile;
 
 
 class LeapMove : public MovementSystem {
+    protected:
+        // Subclasses that override anything pass MoveKind::Custom
+        LeapMove(GamePiece* piece, MoveKind kind);
+
     public:
-        LeapMove(GamePiece* piece);
+        // Tagged MoveKind::Leap, which runs the built-in code and skips any overrides.
+        // Subclasses that override must use the MoveKind::Custom constructor
+        LeapMove(GamePiece* piece) : LeapMove(piece, MoveKind::Leap) {}
         virtual Tile* getDestinationTile(Board& board, char dir) override;
 };
 
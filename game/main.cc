@@ -1,4 +1,10 @@
 #include "controller.h"
+#include "../ai/aiplayer.h"
+#include "../ai/mctsplayer.h"
+#include "../ai/openingbook.h"
+#include "../ai/quantizednetwork.h"
+#include "../ai/searchplayer.h"
+#include "../ai/tablebase.h"
 
 #include <fstream>
 #include <iostream>
@@ -16,6 +22,19 @@ int main(int argc, char * argv[]) {
     bool viewPerPlayer = false;
     bool POVEnabled = false;
     bool aiOpponent = false;
+    std::string engine = "dqn";
+    int searchDepth = 64;
+    int moveTimeMs = 1000;
+    double clockSeconds = 0;
+    double incrementSeconds = 0;
+    bool ponder = false;
+    int hashMb = 0;  // 0 for the engine's own default
+    int threads = 1;
+    int batchSize = 32;
+    std::string modelFile;
+    std::string tablebaseFile;
+    std::string bookFile;
+    std::string int8File;
 
     for (int i = 1; i < argc; i++) {
         command = argv[i];
@@ -36,12 +55,77 @@ int main(int argc, char * argv[]) {
             aiOpponent = true;
         }
 
+        if (command == "-engine" && i + 1 < argc) {
+            engine = argv[++i];
+        }
+
+        if (command == "-depth" && i + 1 < argc) {
+            searchDepth = std::stoi(argv[++i]);
+        }
+
+        if (command == "-movetime" && i + 1 < argc) {
+            moveTimeMs = std::stoi(argv[++i]);
+        }
+
+        if (command == "-clock" && i + 1 < argc) {
+            clockSeconds = std::stod(argv[++i]);
+        }
+
+        if (command == "-inc" && i + 1 < argc) {
+            incrementSeconds = std::stod(argv[++i]);
+        }
+
+        if (command == "-ponder") {
+            ponder = true;
+        }
+
+        if (command == "-hash" && i + 1 < argc) {
+            hashMb = std::stoi(argv[++i]);
+        }
+
+        if (command == "-threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        }
+
+        if (command == "-batch" && i + 1 < argc) {
+            batchSize = std::stoi(argv[++i]);
+        }
+
+        if (command == "-model" && i + 1 < argc) {
+            modelFile = argv[++i];
+        }
+
+        if (command == "-tb" && i + 1 < argc) {
+            tablebaseFile = argv[++i];
+        }
+
+        if (command == "-book" && i + 1 < argc) {
+            bookFile = argv[++i];
+        }
+
+        if (command == "-int8" && i + 1 < argc) {
+            int8File = argv[++i];
+        }
+
         if (command == "-help") {
-            std::cout << "Usage: " << argv[0] << " [-graphics] [-pov] [-splitview] [-ai]" << std::endl;
+            std::cout << "Usage: " << argv[0] << " [-graphics] [-pov] [-splitview] [-ai] [-engine NAME] [-depth N] [-movetime MS] [-clock S] [-inc S] [-ponder] [-hash MB] [-threads N] [-batch N] [-model FILE] [-tb FILE] [-book FILE] [-int8 FILE]" << std::endl;
             std::cout << "  -graphics    Enable graphical interface" << std::endl;
             std::cout << "  -pov         Enable point-of-view mode" << std::endl;
             std::cout << "  -splitview   Enable split view for multiple players" << std::endl;
             std::cout << "  -ai          Play against AI (requires trained model)" << std::endl;
+            std::cout << "  -engine NAME AI engine: dqn, search or mcts (default: dqn)" << std::endl;
+            std::cout << "  -depth N     Deepest search iteration (default: 64)" << std::endl;
+            std::cout << "  -movetime MS Search time per move in milliseconds (default: 1000)" << std::endl;
+            std::cout << "  -clock S     Search game clock in seconds, replaces -movetime" << std::endl;
+            std::cout << "  -inc S       Seconds added to the search clock after each move" << std::endl;
+            std::cout << "  -ponder      Search on the human's time" << std::endl;
+            std::cout << "  -hash MB     Search transposition table (default: 16) or MCTS tree size (default: 256)" << std::endl;
+            std::cout << "  -threads N   Search threads (default: 1)" << std::endl;
+            std::cout << "  -batch N     MCTS leaves per network batch, 1-256 (default: 32)" << std::endl;
+            std::cout << "  -model FILE  Network for the search and mcts engines" << std::endl;
+            std::cout << "  -tb FILE     Endgame tables from tbgen for the dqn and search engines" << std::endl;
+            std::cout << "  -book FILE   Opening book from bookgen" << std::endl;
+            std::cout << "  -int8 FILE   Int8 network from quantize for the dqn engine" << std::endl;
             return 0;
         }
     }
@@ -55,8 +139,65 @@ int main(int argc, char * argv[]) {
     );
 
     if (aiOpponent) {
+        std::shared_ptr<Tablebase> tablebase;
+        if (!tablebaseFile.empty()) {
+            tablebase = std::make_shared<Tablebase>();
+            if (!tablebase->open(tablebaseFile)) {
+                return 1;
+            }
+        }
+
+        std::shared_ptr<OpeningBook> book;
+        if (!bookFile.empty()) {
+            book = std::make_shared<OpeningBook>();
+            if (!book->open(bookFile)) {
+                return 1;
+            }
+        }
+
         // Set player 1 as AI (better performing player from training)
-        controller.setAIPlayer(0, 0.001);
+        char startingPiece = Constants::PLAYER_STARTING_PIECES[0];
+        if (engine == "search") {
+            auto player = std::make_unique<SearchPlayer>(0, startingPiece, searchDepth, moveTimeMs, hashMb ? hashMb : 16, threads);
+            if (!modelFile.empty()) {
+                player->useNetwork(modelFile);
+            }
+            if (clockSeconds > 0) {
+                player->setClock(static_cast<int64_t>(clockSeconds * 1000), static_cast<int>(incrementSeconds * 1000));
+            }
+            player->setPonder(ponder);
+            player->setTablebase(tablebase);
+            player->setOpeningBook(book);
+            controller.setAIPlayer(0, std::move(player));
+        } else if (engine == "mcts") {
+            auto player = std::make_unique<MCTSPlayer>(0, startingPiece, moveTimeMs,
+                                                       hashMb ? hashMb : MCTSPlayer::DEFAULT_MEMORY_MB);
+            player->setThreads(threads);
+            player->setBatchSize(batchSize);
+            player->setOpeningBook(book);
+            if (!modelFile.empty()) {
+                player->useNetwork(modelFile);
+            }
+            controller.setAIPlayer(0, std::move(player));
+        } else {
+            auto player = std::make_unique<AIPlayer>(0, startingPiece, 0.001);
+            player->setTablebase(tablebase);
+            player->setOpeningBook(book);
+            if (!int8File.empty()) {
+                auto network = std::make_shared<QuantizedNetwork>();
+                if (!network->loadFromFile(int8File)) {
+                    return 1;
+                }
+                if (network->getInputSize() != AIPlayer::getNetworkLayers().front() ||
+                    network->getOutputSize() != AIPlayer::getNetworkLayers().back()) {
+                    std::cerr << "Error: " << int8File << " doesn't match the AI player's network" << std::endl;
+                    return 1;
+                }
+                player->setQuantizedNetwork(network);
+                player->setEpsilon(0.05);  // Low exploration for playing
+            }
+            controller.setAIPlayer(0, std::move(player));
+        }
         std::cout << "Playing against AI! You are Player 2." << std::endl;
     }
 
@@ -0,0 +1,42 @@
+#ifndef __MOVE_H__
+#define __MOVE_H__
+
+#include "constants.h"
+
+#include <cstdint>
+
+
+// A single piece move. Squares index the playable area (see GameState).
+struct Move {
+    uint8_t piece; // 0-7, piece strength - 1
+    uint8_t dir;   // index into Constants::DIRECTIONS
+    int8_t from;
+    int8_t to;
+
+    char getPieceId() const { return '1' + piece; }
+    char getDirection() const { return Constants::DIRECTIONS[dir]; }
+    int getActionIndex() const { return piece * Constants::NUM_DIRECTIONS + dir; }
+
+    bool operator==(const Move& other) const {
+        return piece == other.piece && dir == other.dir;
+    }
+    bool operator!=(const Move& other) const { return !(*this == other); }
+};
+
+
+// Fixed-capacity move buffer, every piece can move in at most 4 directions
+struct MoveList {
+    Move moves[Constants::MAX_MOVES];
+    int count = 0;
+
+    void add(const Move& move) { moves[count++] = move; }
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Move& operator[](int i) { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+};
+
+#endif
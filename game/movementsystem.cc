@@ -1,89 +1,24 @@
 #include "movementsystem.h"
+#include "movepolicy.h"
 #include "watermove.h"
 #include "board.h"
 #include "constants.h"
 #include "player.h"
 #include "gamepiece.h"
 #include "tileeffect.h"
+#include "zobrist.h"
 
-#include <iostream> // For debugging only
 
+MovementSystem::MovementSystem(GamePiece* piece, MoveKind kind) : piece(piece), kind(kind) {}
 
-MovementSystem::MovementSystem(GamePiece* piece) : piece(piece) {}
 
+bool MovementSystem::canSwim() const {
+    return false;
+}
 
-Constants::MOVE_RESULT MovementSystem::move(Board& board, char dir) {
-    Tile* currentTile = board.getTile(piece->getRow(), piece->getCol());
-    Tile* newTile = getDestinationTile(board, dir);
-    Player* owner = piece->getOwner();
-    
-    if (!newTile) {
-        std::cout << "DEBUG: Invalid move, destination tile is null (this shouldn't happen?)." << std::endl;
-        return Constants::MOVE_INVALID;
-    }
-    
-    TileEffect* effect = newTile->getTileEffect();
-
-    // Check if moving into opponents goal which the player owns
-    // Need to do this before wall check bc goals are walls, but we move into them
-    // if it's our own goal
-    if (effect && effect->isGoal()) {
-        if (effect->getPlayer() == owner) {
-            effect->onEnter(piece);
-            std::cout << "[INFO] Player " << effect->getPlayer()->getIndex() + 1 << " has reached their goal!" << std::endl;
-        }
-    }
-
-    // Check if moving into a wall (or own goal)
-    if (newTile->getIsWall()) {
-        return Constants::MOVE_WALL;
-    }
-
-    // Can't move into own goal
-    if (effect && effect->isGoal()) {
-        if (effect->getPlayer() != owner) {
-            return Constants::MOVE_WALL;
-        }
-    }
-
-    GamePiece* otherPiece = newTile->getPiece();
-    Player* otherOwner = otherPiece ? otherPiece->getOwner() : nullptr;
-
-    // Check if moving onto one of our own pieces
-    if (otherPiece && otherPiece != piece && otherOwner == owner) {
-        return Constants::MOVE_OWNPIECE;
-    }
-
-    // Call any onEnter effects (before battle)
-    if (effect) {
-        effect->onEnter(piece);
-        if (piece->isDead()) {
-            return Constants::MOVE_KILLED;
-        }
-    }
-
-
-    if (newTile->getIsWater() && !(dynamic_cast<WaterMove*>(piece->getMovementSystem()))) {
-        return Constants::MOVE_WATER_INVALID;
-    }
-
-    // check mouse condition, if one of them is in water, but not both
-    // and one of the pieces is mouse
-    if (otherPiece && (currentTile->getIsWater() ^ newTile->getIsWater()) && (piece->getStrength() == 1 || otherPiece->getStrength() == 1)) {
-        return Constants::MOVE_RAT_INVALID;
-    }
-
-    if (otherPiece && otherOwner != owner) {
-        battle(otherPiece);
-        if (piece->isDead()) {
-            return Constants::MOVE_KILLED;
-        }
-    }
-
-    leaveTile();
-    enterTile(newTile);
 
-    return Constants::MOVE_SUCCESS;
+Constants::MOVE_RESULT MovementSystem::move(Board& board, char dir) {
+    return moveAs<MoveKind::Custom>(board, dir);
 }
 
 
@@ -91,9 +26,12 @@ void MovementSystem::leaveTile() {
     Tile* currentTile = piece->getBoard()->getTile(piece->getRow(), piece->getCol());
 
     if (currentTile->getTileEffect()) {
-        currentTile->getTileEffect()->onLeave(piece);
+        MoveDispatch::onLeave(currentTile->getTileEffect(), piece);
     }
 
+    piece->getBoard()->xorHash(Zobrist::piece(piece->getOwner()->getIndex(), piece->getPieceIndex(),
+        GameState::toSquare(piece->getRow(), piece->getCol())));
+
     piece->setPosition(-1, -1); // Invalid position
     currentTile->setPiece(nullptr);
 
@@ -106,6 +44,9 @@ void MovementSystem::leaveTile() {
 
 
 void MovementSystem::enterTile(Tile* tile) {
+    piece->getBoard()->xorHash(Zobrist::piece(piece->getOwner()->getIndex(), piece->getPieceIndex(),
+        GameState::toSquare(tile->getRow(), tile->getColumn())));
+
     piece->setPosition(tile->getRow(), tile->getColumn());
     tile->setPiece(piece);
     tile->notify();
@@ -155,8 +96,6 @@ bool MovementSystem::battle(GamePiece* opponent) {
     }
 
     // Winner remains on board
-    // std::cout << "[INFO] Player " << winner->getIndex() + 1 << " wins battle vs Player " << loser->getIndex() + 1 << std::endl;
-
     defeatedGamePiece->remove();
 
     // Notify board of winner (bc. it's revealed, shows in graphics)
@@ -7,15 +7,40 @@ class Board;
 class GamePiece;
 class Tile;
 
+// Built-in movement rules, fixed when the piece is made. GamePiece::move
+// switches on this to a statically dispatched moveAs<Kind>, which ignores
+// overrides. Decorators, new pieces and subclasses that override anything
+// pass Custom and take the virtual path.
+enum class MoveKind {
+    Normal,
+    Water,
+    Leap,
+    Custom
+};
+
 class MovementSystem {
     protected:
         GamePiece* piece;
+        MoveKind kind;
         virtual bool battle(GamePiece* opponent);
         virtual Tile* getDestinationTile(Board& board, char dir) = 0;
 
     public:
-        MovementSystem(GamePiece* piece);
+        MovementSystem(GamePiece* piece, MoveKind kind = MoveKind::Custom);
+        virtual ~MovementSystem() = default;
+        MoveKind getKind() const { return kind; }
+
+        // Whether the piece may stand in water, checked on the Custom path
+        virtual bool canSwim() const;
+
+        // Generic path, calls moveAs<MoveKind::Custom>
         virtual Constants::MOVE_RESULT move(Board& board, char dir);
+
+        // Rules of MovementSystem::move with destination and water access
+        // resolved at compile time, defined in movepolicy.h
+        template <MoveKind Kind>
+        Constants::MOVE_RESULT moveAs(Board& board, char dir);
+
         virtual void leaveTile();
         virtual void enterTile(Tile* tile);
         void setGamePiece(GamePiece* piece);
@@ -0,0 +1,194 @@
+#ifndef __MOVEPOLICY_H__
+#define __MOVEPOLICY_H__
+
+// Compile-time movement policies and the body of MovementSystem::moveAs.
+// Needs the full Board/Tile/GamePiece types, so only include it from .cc files.
+
+#include "board.h"
+#include "constants.h"
+#include "gamepiece.h"
+#include "goaleffect.h"
+#include "movementsystem.h"
+#include "player.h"
+#include "tile.h"
+#include "tileeffect.h"
+#include "trapeffect.h"
+
+#include <cctype>
+
+
+// Where a piece ends up and whether it may stand in water, per movement
+// class. dir is an index into Constants::DIRECTIONS.
+template <MoveKind Kind>
+struct MovePolicy {
+    // Custom movement goes through the virtual getDestinationTile instead
+    static constexpr bool canSwim = false;
+    static Tile* destination(Board& board, int row, int col, int dir) {
+        return nullptr;
+    }
+};
+
+template <>
+struct MovePolicy<MoveKind::Normal> {
+    static constexpr bool canSwim = false;
+    static Tile* destination(Board& board, int row, int col, int dir) {
+        return board.getTile(row + Constants::DIRECTION_ROW_STEP[dir], col + Constants::DIRECTION_COL_STEP[dir]);
+    }
+};
+
+template <>
+struct MovePolicy<MoveKind::Water> {
+    static constexpr bool canSwim = true;
+    static Tile* destination(Board& board, int row, int col, int dir) {
+        return board.getTile(row + Constants::DIRECTION_ROW_STEP[dir], col + Constants::DIRECTION_COL_STEP[dir]);
+    }
+};
+
+template <>
+struct MovePolicy<MoveKind::Leap> {
+    static constexpr bool canSwim = false;
+    static Tile* destination(Board& board, int row, int col, int dir) {
+        return board.getLeapDestination(row, col, dir);
+    }
+};
+
+
+namespace MoveDispatch {
+    // Index into Constants::DIRECTIONS, -1 for anything else
+    inline int directionIndex(char dir) {
+        switch (std::toupper(dir)) {
+            case 'N': return 0;
+            case 'S': return 1;
+            case 'E': return 2;
+            case 'W': return 3;
+            default: return -1;
+        }
+    }
+
+    // Trap and Goal tags mean the built-in rules, so these calls are
+    // qualified and skip the vtable, like moveAs does for the movement
+    inline bool isGoal(TileEffect* effect) {
+        switch (effect->getKind()) {
+            case EffectKind::Goal: return true;
+            case EffectKind::Trap: return false;
+            default: return effect->isGoal();
+        }
+    }
+
+    inline void onEnter(TileEffect* effect, GamePiece* piece) {
+        switch (effect->getKind()) {
+            case EffectKind::Trap: static_cast<TrapEffect*>(effect)->TrapEffect::onEnter(piece); break;
+            case EffectKind::Goal: static_cast<GoalEffect*>(effect)->GoalEffect::onEnter(piece); break;
+            default: effect->onEnter(piece); break;
+        }
+    }
+
+    inline void onLeave(TileEffect* effect, GamePiece* piece) {
+        switch (effect->getKind()) {
+            case EffectKind::Trap: static_cast<TrapEffect*>(effect)->TrapEffect::onLeave(piece); break;
+            case EffectKind::Goal: static_cast<GoalEffect*>(effect)->GoalEffect::onLeave(piece); break;
+            default: effect->onLeave(piece); break;
+        }
+    }
+}
+
+
+template <MoveKind Kind>
+Constants::MOVE_RESULT MovementSystem::moveAs(Board& board, char dir) {
+    // Built-in kinds mean the built-in rules, so the battle/leave/enter
+    // calls below can skip the vtable
+    constexpr bool custom = (Kind == MoveKind::Custom);
+
+    Tile* currentTile = board.getTile(piece->getRow(), piece->getCol());
+    Tile* newTile = nullptr;
+    Player* owner = piece->getOwner();
+
+    if (custom) {
+        newTile = getDestinationTile(board, dir);
+    }
+    else {
+        int index = MoveDispatch::directionIndex(dir);
+        if (index >= 0) {
+            newTile = MovePolicy<Kind>::destination(board, piece->getRow(), piece->getCol(), index);
+        }
+    }
+
+    if (!newTile) {
+        return Constants::MOVE_INVALID;
+    }
+
+    TileEffect* effect = newTile->getTileEffect();
+    bool isGoal = effect && MoveDispatch::isGoal(effect);
+
+    // Check if moving into opponents goal which the player owns
+    // Need to do this before wall check bc goals are walls, but we move into them
+    // if it's our own goal
+    if (isGoal && effect->getPlayer() == owner) {
+        MoveDispatch::onEnter(effect, piece);
+    }
+
+    // Check if moving into a wall (or own goal)
+    if (newTile->getIsWall()) {
+        return Constants::MOVE_WALL;
+    }
+
+    // Can't move into own goal
+    if (isGoal && effect->getPlayer() != owner) {
+        return Constants::MOVE_WALL;
+    }
+
+    GamePiece* otherPiece = newTile->getPiece();
+    Player* otherOwner = otherPiece ? otherPiece->getOwner() : nullptr;
+
+    // Check if moving onto one of our own pieces
+    if (otherPiece && otherPiece != piece && otherOwner == owner) {
+        return Constants::MOVE_OWNPIECE;
+    }
+
+    // Call any onEnter effects (before battle)
+    if (effect) {
+        MoveDispatch::onEnter(effect, piece);
+        if (piece->isDead()) {
+            board.switchSideToMove();
+            return Constants::MOVE_KILLED;
+        }
+    }
+
+    bool canSwim = custom ? this->canSwim() : MovePolicy<Kind>::canSwim;
+    if (newTile->getIsWater() && !canSwim) {
+        return Constants::MOVE_WATER_INVALID;
+    }
+
+    // check mouse condition, if one of them is in water, but not both
+    // and one of the pieces is mouse
+    if (otherPiece && (currentTile->getIsWater() ^ newTile->getIsWater()) && (piece->getStrength() == 1 || otherPiece->getStrength() == 1)) {
+        return Constants::MOVE_RAT_INVALID;
+    }
+
+    if (otherPiece && otherOwner != owner) {
+        if (custom) {
+            battle(otherPiece);
+        }
+        else {
+            MovementSystem::battle(otherPiece);
+        }
+        if (piece->isDead()) {
+            board.switchSideToMove();
+            return Constants::MOVE_KILLED;
+        }
+    }
+
+    if (custom) {
+        leaveTile();
+        enterTile(newTile);
+    }
+    else {
+        MovementSystem::leaveTile();
+        MovementSystem::enterTile(newTile);
+    }
+    board.switchSideToMove();
+
+    return Constants::MOVE_SUCCESS;
+}
+
+#endif
@@ -7,7 +7,7 @@
 #include "tileeffect.h"
 
 
-NormalMove::NormalMove(GamePiece* piece) : MovementSystem(piece) {}
+NormalMove::NormalMove(GamePiece* piece, MoveKind kind) : MovementSystem(piece, kind) {}
 
 
 bool NormalMove::shouldStop(Board& board, int row, int col) {
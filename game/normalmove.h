@@ -12,8 +12,14 @@ class Tile;
 class NormalMove : public MovementSystem {
     bool shouldStop(Board& board, int row, int col);
     
+    protected:
+        // Subclasses that override anything pass MoveKind::Custom
+        NormalMove(GamePiece* piece, MoveKind kind);
+
     public:
-        NormalMove(GamePiece* piece);
+        // Tagged MoveKind::Normal, which runs the built-in code and skips any overrides.
+        // Subclasses that override must use the MoveKind::Custom constructor
+        NormalMove(GamePiece* piece) : NormalMove(piece, MoveKind::Normal) {}
         virtual Tile* getDestinationTile(Board& board, char dir) override;
 };
 
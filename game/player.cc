@@ -7,7 +7,7 @@
 
 
 Player::Player(int index, char startingPiece)
-    : index{index}, isDeleted{false} {
+    : index{index}, isDeleted{false}, hasWon{false} {
     for (char c = startingPiece; c < startingPiece + Constants::NUM_PIECES; c++) {
         pieces[c] = nullptr;
     }
@@ -55,9 +55,16 @@ void Player::deletePlayer() {
 }
 
 Constants::MOVE_RESULT Player::move(Board* board, char pieceId, char dir) {
-    if (pieces[pieceId]->isDead()) {
+    // Positions loaded from a file may leave pieces out altogether
+    auto piece = pieces.find(pieceId);
+    if (piece == pieces.end() || !piece->second || piece->second->isDead()) {
         return Constants::MOVE_INVALID;
     }
 
-    return pieces[pieceId]->getMovementSystem()->move(*board, dir);
+    return piece->second->move(*board, dir);
+}
+
+Move Player::chooseMove(Board* board, const MoveList& legalMoves) {
+    // Human players are asked for input instead, nothing to choose from here
+    return legalMoves[0];
 }
@@ -3,6 +3,7 @@
 
 #include "constants.h"
 #include "gamepiece.h"
+#include "move.h"
 
 #include <map>
 #include <memory>
@@ -27,7 +28,21 @@ class Player {
         bool getHasWon() const;
         void deletePlayer();
         Constants::MOVE_RESULT move(Board* board, char pieceId, char dir);
+
+        // Computer players override this to pick one of legalMoves (from
+        // Board::generateLegalMoves, never empty) for the controller
+        virtual Move chooseMove(Board* board, const MoveList& legalMoves);
+
+        // Called after a computer player's move when a human is to move
+        // next, so it can think on their time until its next chooseMove
+        // or stopPondering. Nothing by default.
+        virtual void startPondering(Board* board) {}
+        virtual void stopPondering() {}
+
         Player(int index, char startingPiece);
+        virtual ~Player() = default;
+        Player(Player&& other) = default;
+        Player& operator=(Player&& other) = default;
 };
 
 #endif
\ No newline at end of file
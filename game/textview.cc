@@ -31,11 +31,10 @@ void TextView::notify(const Tile& tile) {
         grid[row][col] = 'W';
     }
     else if (tileEffect) {
-        // type checking
-        if (auto* g = dynamic_cast<GoalEffect*>(tileEffect)) {
+        if (tileEffect->isGoal()) {
             grid[row][col] = 'G';
         }
-        else if (auto* t = dynamic_cast<TrapEffect*>(tileEffect)) {
+        else if (tileEffect->isTrap()) {
             grid[row][col] = 'T';
         }
         else {
@@ -33,6 +33,7 @@ GamePiece* Tile::getPiece() const {
 
 void Tile::setPiece(GamePiece* piece) {
     this->piece = piece;
+    board->setOccupied(row, col, piece != nullptr);
 }
 
 bool Tile::getIsWall() const {
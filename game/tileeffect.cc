@@ -1,7 +1,7 @@
 #include "tileeffect.h"
 #include "player.h"
 
-TileEffect::TileEffect(Player* player) : player(player) {}
+TileEffect::TileEffect(Player* player, EffectKind kind) : player(player), kind(kind) {}
 
 
 TileEffect::~TileEffect() = default;
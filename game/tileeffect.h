@@ -4,17 +4,28 @@
 class GamePiece;
 class Player;
 
+// Built-in effects are tagged so the move path can call them without
+// virtual dispatch. Custom effects, including subclasses of the built-in
+// ones that override anything, always go through the virtuals
+enum class EffectKind {
+    Trap,
+    Goal,
+    Custom
+};
+
 class TileEffect {
     protected:
         Player* player;
+        EffectKind kind;
     
     public:
-        TileEffect(Player* player);
+        TileEffect(Player* player, EffectKind kind = EffectKind::Custom);
         virtual ~TileEffect() = 0; // Abstract class
 
         virtual void onEnter(GamePiece* piece);
         virtual void onLeave(GamePiece* piece);
         Player* getPlayer();
+        EffectKind getKind() const { return kind; }
 
         virtual bool isTrap() const;
         virtual bool isGoal() const;
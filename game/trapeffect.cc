@@ -1,7 +1,7 @@
 #include "trapeffect.h"
 #include "gamepiece.h"
 
-TrapEffect::TrapEffect(Player* player) : TileEffect(player) {}
+TrapEffect::TrapEffect(Player* player, EffectKind kind) : TileEffect(player, kind) {}
 
 
 void TrapEffect::onEnter(GamePiece* piece) {
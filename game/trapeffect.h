@@ -6,8 +6,14 @@
 class GamePiece;
 
 class TrapEffect : public TileEffect {
+    protected:
+        // Subclasses that override anything pass EffectKind::Custom
+        TrapEffect(Player* player, EffectKind kind);
+
     public:
-        TrapEffect(Player* player);
+        // Tagged EffectKind::Trap, which runs the built-in code and skips any overrides.
+        // Subclasses that override must use the EffectKind::Custom constructor
+        TrapEffect(Player* player) : TrapEffect(player, EffectKind::Trap) {}
         void onEnter(GamePiece* piece) override;
         void onLeave(GamePiece* piece) override;
         bool isTrap() const override;
@@ -7,7 +7,12 @@
 #include "tileeffect.h"
 
 
-WaterMove::WaterMove(GamePiece* piece) : MovementSystem(piece) {}
+WaterMove::WaterMove(GamePiece* piece, MoveKind kind) : MovementSystem(piece, kind) {}
+
+
+bool WaterMove::canSwim() const {
+    return true;
+}
 
 
 bool WaterMove::shouldStop(Board& board, int row, int col) {
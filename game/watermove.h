@@ -12,9 +12,16 @@ class Tile;
 class WaterMove : public MovementSystem {
     bool shouldStop(Board& board, int row, int col);
     
+    protected:
+        // Subclasses that override anything pass MoveKind::Custom
+        WaterMove(GamePiece* piece, MoveKind kind);
+
     public:
-        WaterMove(GamePiece* piece);
+        // Tagged MoveKind::Water, which runs the built-in code and skips any overrides.
+        // Subclasses that override must use the MoveKind::Custom constructor
+        WaterMove(GamePiece* piece) : WaterMove(piece, MoveKind::Water) {}
         virtual Tile* getDestinationTile(Board& board, char dir) override;
+        bool canSwim() const override;
 };
 
 #endif
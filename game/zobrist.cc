@@ -0,0 +1,31 @@
+#include "zobrist.h"
+
+#include "constants.h"
+#include "gamestate.h"
+
+
+// constexpr constructor, so the table is built at compile time
+const Zobrist::Keys Zobrist::KEYS{};
+
+
+uint64_t Zobrist::hash(const GameState& state) {
+    uint64_t key = 0;
+
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < Constants::NUM_PIECES; i++) {
+            int square = state.pieceSquare[p][i];
+            if (square < 0) continue;
+
+            key ^= piece(p, i, square);
+            if (state.isTrap(square)) {
+                key ^= trapped(p, i);
+            }
+        }
+    }
+
+    if (state.sideToMove == 1) {
+        key ^= side();
+    }
+
+    return key;
+}
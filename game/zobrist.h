@@ -0,0 +1,59 @@
+#ifndef __ZOBRIST_H__
+#define __ZOBRIST_H__
+
+#include "constants.h"
+
+#include <cstdint>
+
+
+struct GameState;
+
+// Random 64 bit keys XORed together to identify a position. A key covers
+// every piece on its square, every trapped piece and the side to move.
+namespace Zobrist {
+    struct Keys {
+        uint64_t piece[2][Constants::NUM_PIECES][Constants::NUM_SQUARES];
+        uint64_t trapped[2][Constants::NUM_PIECES];
+        uint64_t side;
+
+        // splitmix64 with a fixed seed so keys are stable between runs
+        constexpr Keys() : piece{}, trapped{}, side{0} {
+            uint64_t seed = 0x416e696d616c4368ULL;
+            for (int p = 0; p < 2; p++) {
+                for (int i = 0; i < Constants::NUM_PIECES; i++) {
+                    for (int sq = 0; sq < Constants::NUM_SQUARES; sq++) {
+                        piece[p][i][sq] = next(seed);
+                    }
+                    trapped[p][i] = next(seed);
+                }
+            }
+            side = next(seed);
+        }
+
+        static constexpr uint64_t next(uint64_t& seed) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    };
+
+    extern const Keys KEYS;
+
+    inline uint64_t piece(int player, int piece, int square) {
+        return KEYS.piece[player][piece][square];
+    }
+
+    inline uint64_t trapped(int player, int piece) {
+        return KEYS.trapped[player][piece];
+    }
+
+    inline uint64_t side() {
+        return KEYS.side;
+    }
+
+    // Full recomputation, incremental updates must always agree with this
+    uint64_t hash(const GameState& state);
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "../ai/openingbook.h"
+#include "../game/board.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Counts for one (position, move), keyed by hash and action together
+struct MoveStats {
+    uint32_t games = 0;
+    uint32_t wins = 0;
+    uint32_t draws = 0;
+};
+
+using BookMap = std::unordered_map<uint64_t, std::unordered_map<int, MoveStats>>;
+
+
+// Replays one record line ("winner move move ...") from start, adding its
+// first maxPlies moves to book. False if the line isn't a legal game.
+bool addGame(const std::string& line, const GameState& start, int maxPlies, BookMap& book) {
+    std::istringstream stream{line};
+    int winner;
+    if (!(stream >> winner) || winner < -1 || winner > 1) return false;
+
+    GameState state = start;
+    std::string token;
+    for (int ply = 0; ply < maxPlies && stream >> token; ply++) {
+        if (token.size() != 2) return false;
+
+        int piece = token[0] - '1';
+        const char* dirFound = std::find(Constants::DIRECTIONS, Constants::DIRECTIONS + Constants::NUM_DIRECTIONS, token[1]);
+        int dir = dirFound - Constants::DIRECTIONS;
+        if (piece < 0 || piece >= Constants::NUM_PIECES || dir >= Constants::NUM_DIRECTIONS) return false;
+
+        Move move;
+        Constants::MOVE_RESULT result = state.resolve(piece, dir, move);
+        if (result != Constants::MOVE_SUCCESS && result != Constants::MOVE_KILLED) return false;
+
+        MoveStats& stats = book[state.hash][move.getActionIndex()];
+        stats.games++;
+        if (winner == state.sideToMove) stats.wins++;
+        if (winner == -1) stats.draws++;
+
+        state.play(move);
+        if (state.isGameOver()) break;
+    }
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    int maxPlies = 20;
+    int minGames = 3;
+    std::string outFile = "opening.book";
+    std::string boardFile = Constants::BOARD_2_PLAYER;
+    std::vector<std::string> recordFiles;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-plies" && i + 1 < argc) {
+            maxPlies = std::stoi(argv[++i]);
+        } else if (arg == "-min" && i + 1 < argc) {
+            minGames = std::stoi(argv[++i]);
+        } else if (arg == "-out" && i + 1 < argc) {
+            outFile = argv[++i];
+        } else if (arg == "-board" && i + 1 < argc) {
+            boardFile = argv[++i];
+        } else if (arg == "-help") {
+            std::cout << "Usage: " << argv[0] << " [options] RECORD..." << std::endl;
+            std::cout << "Builds an opening book from game records written by aitrain -record" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -plies N       Moves from the start of each game to use (default: 20)" << std::endl;
+            std::cout << "  -min N         Leave out moves played fewer times (default: 3)" << std::endl;
+            std::cout << "  -out FILE      Book file to write (default: opening.book)" << std::endl;
+            std::cout << "  -board FILE    Start position in board.txt format (default: board.txt)" << std::endl;
+            std::cout << "  -help          Show this help message" << std::endl;
+            return 0;
+        } else {
+            recordFiles.push_back(arg);
+        }
+    }
+
+    if (recordFiles.empty()) {
+        std::cerr << "Error: No game records given, see -help" << std::endl;
+        return 1;
+    }
+
+    GameState start;
+    if (!Board::loadLayout(boardFile, start)) {
+        return 1;
+    }
+
+    BookMap book;
+    uint64_t games = 0;
+    uint64_t skipped = 0;
+    for (const std::string& recordFile : recordFiles) {
+        std::ifstream records{recordFile};
+        if (!records) {
+            std::cerr << "Could not read or open file: " << recordFile << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(records, line)) {
+            if (line.empty()) continue;
+            if (addGame(line, start, maxPlies, book)) {
+                games++;
+            } else {
+                skipped++;
+            }
+        }
+    }
+
+    std::vector<BookEntry> entries;
+    for (const auto& position : book) {
+        for (const auto& move : position.second) {
+            if (move.second.games < static_cast<uint32_t>(minGames)) continue;
+
+            BookEntry entry{};
+            entry.key = position.first;
+            entry.action = move.first;
+            entry.games = move.second.games;
+            entry.wins = move.second.wins;
+            entry.draws = move.second.draws;
+            entries.push_back(entry);
+        }
+    }
+
+    // The probe binary searches on key, then scans the key's moves
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.key != b.key ? a.key < b.key : a.action < b.action;
+    });
+
+    std::ofstream file{outFile, std::ios::binary};
+    OpeningBook::FileHeader header = OpeningBook::makeHeader(start, entries.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BookEntry));
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Could not write " << outFile << std::endl;
+        return 1;
+    }
+
+    std::cout << games << " games (" << skipped << " skipped), " << book.size() << " positions, "
+              << entries.size() << " book moves played at least " << minGames << " times" << std::endl;
+
+    // The start position is what every game asks first
+    OpeningBook check;
+    if (!check.open(outFile)) {
+        return 1;
+    }
+    Move move;
+    BookEntry stats;
+    if (check.probe(start, move, stats)) {
+        std::cout << "Start position: " << move.getPieceId() << move.getDirection() << " played "
+                  << stats.games << " times, scoring " << stats.getScore() * 100 << "%" << std::endl;
+    }
+    std::cout << "Wrote " << outFile << std::endl;
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "../ai/ainetwork.h"
+#include "../ai/gemv.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// The network's layers (AIPlayer::getNetworkLayers), inputs x outputs
+const int SHAPES[][2] = {{396, 256}, {256, 128}, {128, 64}, {64, 32}};
+// Inputs per batched call, a replay batch of states and next states
+const int BATCH = 64;
+
+// Keeps the compiler from dropping the benchmarked calls
+volatile float sink;
+
+
+// GFLOP/s of run, which does flops floating point operations, calling it
+// for at least seconds
+template <typename Run>
+double measure(Run run, double flops, double seconds) {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t calls = 0;
+    int batch = 16;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    while (elapsed < seconds) {
+        for (int i = 0; i < batch; i++) {
+            run();
+        }
+        calls += batch;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return flops * calls / elapsed / 1e9;
+}
+
+// Largest difference from expected, relative to its largest value
+float relativeError(const std::vector<float>& output, const std::vector<float>& expected) {
+    float scale = 1e-6f;
+    for (float value : expected) {
+        scale = std::max(scale, std::fabs(value));
+    }
+    float error = 0.0f;
+    for (size_t i = 0; i < output.size(); i++) {
+        error = std::max(error, std::fabs(output[i] - expected[i]) / scale);
+    }
+    return error;
+}
+
+void randomLayer(NetworkLayer& layer, int inputs, int outputs, std::mt19937& rng) {
+    std::normal_distribution<float> weightDist(0.0f, 0.1f);
+    layer.allocate(inputs, outputs);
+    for (int i = 0; i < layer.outputs; i++) {
+        layer.biases()[i] = weightDist(rng);
+        for (int j = 0; j < layer.inputs; j++) {
+            layer.row(i)[j] = weightDist(rng);
+        }
+    }
+}
+
+std::vector<float> randomInput(int size, std::mt19937& rng) {
+    std::uniform_real_distribution<float> inputDist(0.0f, 1.0f);
+    std::vector<float> input(size);
+    for (float& value : input) {
+        value = inputDist(rng);
+    }
+    return input;
+}
+
+std::string shapeName(const int* shape) {
+    return std::to_string(shape[0]) + "x" + std::to_string(shape[1]);
+}
+
+
+int main(int argc, char* argv[]) {
+    int timeMs = 200;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-time" && i + 1 < argc) {
+            timeMs = std::stoi(argv[++i]);
+        } else if (arg == "-help") {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cout << "Times the network layer kernels on each instruction set the CPU has" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -time MS       Time per kernel and layer shape (default: 200)" << std::endl;
+            std::cout << "  -help          Show this help message" << std::endl;
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    const Gemv::Isa isas[] = {Gemv::Isa::Scalar, Gemv::Isa::SSE2, Gemv::Isa::AVX2, Gemv::Isa::AVX512};
+    double seconds = timeMs / 1000.0;
+    std::mt19937 rng(12345);
+    float maxError = 0.0f;
+
+    std::cout << "gemv benchmark (bias and ReLU fused), GFLOP/s, " << timeMs << "ms per kernel and shape, "
+              << Gemv::getName(Gemv::getBestIsa()) << " is used" << std::endl;
+    std::cout << std::setw(10) << "shape";
+    for (Gemv::Isa isa : isas) {
+        std::cout << std::setw(10) << Gemv::getName(isa);
+    }
+    std::cout << std::setw(12) << "max error" << std::endl;
+
+    for (const auto& shape : SHAPES) {
+        NetworkLayer layer;
+        randomLayer(layer, shape[0], shape[1], rng);
+        std::vector<float> input = randomInput(layer.inputs, rng);
+
+        std::vector<float> expected(layer.outputs);
+        Gemv::getKernel(Gemv::Isa::Scalar)(layer.row(0), layer.stride, layer.biases(), input.data(),
+                                           layer.inputs, layer.outputs, expected.data(), true);
+
+        std::cout << std::setw(10) << shapeName(shape);
+        float shapeError = 0.0f;
+        for (Gemv::Isa isa : isas) {
+            Gemv::Kernel kernel = Gemv::getKernel(isa);
+            if (!kernel) {
+                std::cout << std::setw(10) << "-";
+                continue;
+            }
+
+            std::vector<float> output(layer.outputs);
+            auto run = [&] {
+                kernel(layer.row(0), layer.stride, layer.biases(), input.data(), layer.inputs, layer.outputs, output.data(), true);
+                sink = output[0];
+            };
+            // Vector kernels add in another order, compare relative to the
+            // largest output
+            run();
+            shapeError = std::max(shapeError, relativeError(output, expected));
+
+            double gflops = measure(run, 2.0 * layer.inputs * layer.outputs, seconds);
+            std::cout << std::setw(10) << std::fixed << std::setprecision(2) << gflops;
+        }
+        std::cout << std::setw(12) << std::scientific << std::setprecision(1) << shapeError << std::endl;
+        maxError = std::max(maxError, shapeError);
+    }
+
+    // The same layers over a batch of inputs, as AINetwork::predictBatch
+    // runs them, against one matrix-vector call per input
+    std::cout << std::endl << "gemm benchmark, batches of " << BATCH << ", GFLOP/s" << std::endl;
+    std::cout << std::setw(10) << "shape";
+    for (Gemv::Isa isa : isas) {
+        std::cout << std::setw(10) << Gemv::getName(isa);
+    }
+    std::cout << std::setw(10) << "speedup" << std::setw(12) << "max error" << std::endl;
+
+    const Gemv::Kernel bestKernel = Gemv::getKernel(Gemv::getBestIsa());
+    const int columns = NetworkLayer::roundToLine(BATCH);
+    for (const auto& shape : SHAPES) {
+        NetworkLayer layer;
+        randomLayer(layer, shape[0], shape[1], rng);
+        double flops = 2.0 * layer.inputs * layer.outputs * BATCH;
+
+        // One input per row for gemv, one per column for gemm
+        std::vector<float> input = randomInput(layer.inputs * BATCH, rng);
+        auto columnInput = NetworkLayer::alignedBlock(static_cast<size_t>(layer.inputs) * columns);
+        for (int b = 0; b < BATCH; b++) {
+            for (int j = 0; j < layer.inputs; j++) {
+                columnInput[j * columns + b] = input[b * layer.inputs + j];
+            }
+        }
+
+        size_t outputSize = static_cast<size_t>(layer.outputs) * columns;
+        std::vector<float> expected(outputSize);
+        Gemv::getBatchKernel(Gemv::Isa::Scalar)(layer.row(0), layer.stride, layer.biases(), columnInput.get(),
+                                                layer.inputs, layer.outputs, expected.data(), columns, true);
+
+        std::cout << std::setw(10) << shapeName(shape);
+        float shapeError = 0.0f;
+        double bestGflops = 0.0;
+        auto output = NetworkLayer::alignedBlock(outputSize);
+        for (Gemv::Isa isa : isas) {
+            Gemv::BatchKernel kernel = Gemv::getBatchKernel(isa);
+            if (!kernel) {
+                std::cout << std::setw(10) << "-";
+                continue;
+            }
+
+            auto run = [&] {
+                kernel(layer.row(0), layer.stride, layer.biases(), columnInput.get(),
+                       layer.inputs, layer.outputs, output.get(), columns, true);
+                sink = output[0];
+            };
+            run();
+            shapeError = std::max(shapeError, relativeError(std::vector<float>(output.get(), output.get() + outputSize), expected));
+
+            double gflops = measure(run, flops, seconds);
+            bestGflops = std::max(bestGflops, gflops);
+            std::cout << std::setw(10) << std::fixed << std::setprecision(2) << gflops;
+        }
+
+        std::vector<float> rowOutput(layer.outputs * BATCH);
+        auto perInput = [&] {
+            for (int b = 0; b < BATCH; b++) {
+                bestKernel(layer.row(0), layer.stride, layer.biases(), input.data() + b * layer.inputs,
+                           layer.inputs, layer.outputs, rowOutput.data() + b * layer.outputs, true);
+            }
+            sink = rowOutput[0];
+        };
+        double gemvGflops = measure(perInput, flops, seconds);
+        std::cout << std::setw(9) << std::fixed << std::setprecision(2) << bestGflops / gemvGflops << "x"
+                  << std::setw(12) << std::scientific << std::setprecision(1) << shapeError << std::endl;
+        maxError = std::max(maxError, shapeError);
+    }
+    std::cout << "(speedup is the fastest batched kernel over " << BATCH << " "
+              << Gemv::getName(Gemv::getBestIsa()) << " gemv calls)" << std::endl;
+
+    if (maxError >= 1e-4f) {
+        std::cerr << "Error: a vector kernel is off from the scalar one by more than 1e-4" << std::endl;
+        return 1;
+    }
+    return 0;
+}
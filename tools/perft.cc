@@ -0,0 +1,296 @@
+#include "../game/board.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+#include "../game/player.h"
+#include "../game/zobrist.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Counts leaf nodes of the game tree to a fixed depth. Each engine applies
+// the rules its own way, so matching counts show they agree.
+class PerftEngine {
+    public:
+        virtual ~PerftEngine() = default;
+        virtual const char* getName() const = 0;
+        virtual bool play(int piece, int dir) = 0; // false if the move is illegal
+        virtual void undo() = 0;
+        virtual uint64_t perft(int depth) = 0;
+};
+
+
+// Object-graph rules: every piece/direction goes through Player::move and
+// MovementSystem::move, the position is restored from a snapshot afterwards
+class ObjectEngine : public PerftEngine {
+    Board& board;
+    std::vector<Player>& players;
+    std::vector<GameState> snapshots;
+
+    public:
+        ObjectEngine(Board& board, std::vector<Player>& players) : board{board}, players{players} {}
+
+        const char* getName() const override { return "object"; }
+
+        bool play(int piece, int dir) override {
+            GameState snapshot = board.saveState();
+            if (snapshot.isGameOver()) return false;
+
+            int side = board.getSideToMove();
+            char pieceId = Constants::PLAYER_STARTING_PIECES[side] + piece;
+            Constants::MOVE_RESULT result = players[side].move(&board, pieceId, Constants::DIRECTIONS[dir]);
+
+            if (result != Constants::MOVE_SUCCESS && result != Constants::MOVE_KILLED) {
+                return false;
+            }
+            snapshots.push_back(snapshot);
+            return true;
+        }
+
+        void undo() override {
+            board.loadState(snapshots.back());
+            snapshots.pop_back();
+        }
+
+        uint64_t perft(int depth) override {
+            if (depth == 0) return 1;
+
+            uint64_t nodes = 0;
+            for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+                for (int dir = 0; dir < Constants::NUM_DIRECTIONS; dir++) {
+                    if (play(piece, dir)) {
+                        nodes += perft(depth - 1);
+                        undo();
+                    }
+                }
+            }
+            return nodes;
+        }
+};
+
+
+// Board::generateLegalMoves with in-place Board::makeMove/unmakeMove
+class BoardEngine : public PerftEngine {
+    Board& board;
+
+    bool gameOver() {
+        return board.saveState().isGameOver();
+    }
+
+    public:
+        BoardEngine(Board& board) : board{board} {}
+
+        const char* getName() const override { return "board"; }
+
+        bool play(int piece, int dir) override {
+            if (gameOver()) return false;
+
+            MoveList moves;
+            board.generateLegalMoves(board.getSideToMove(), moves);
+            for (const Move& move : moves) {
+                if (move.piece == piece && move.dir == dir) {
+                    board.makeMove(move);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void undo() override {
+            board.unmakeMove();
+        }
+
+        uint64_t perft(int depth) override {
+            if (depth == 0) return 1;
+            if (gameOver()) return 0;
+
+            MoveList moves;
+            board.generateLegalMoves(board.getSideToMove(), moves);
+            if (depth == 1) return moves.size();
+
+            uint64_t nodes = 0;
+            for (const Move& move : moves) {
+                board.makeMove(move);
+                nodes += perft(depth - 1);
+                board.unmakeMove();
+            }
+            return nodes;
+        }
+};
+
+
+// GameState copy-make with the bitboard move generator
+class StateEngine : public PerftEngine {
+    std::vector<GameState> stack;
+
+    static uint64_t perft(const GameState& state, int depth) {
+        MoveList moves;
+        state.generateMoves(moves);
+        if (depth == 1) return moves.size();
+
+        uint64_t nodes = 0;
+        for (const Move& move : moves) {
+            GameState next = state;
+            next.play(move);
+            nodes += perft(next, depth - 1);
+        }
+        return nodes;
+    }
+
+    public:
+        StateEngine(const GameState& root) : stack{root} {}
+
+        const char* getName() const override { return "state"; }
+
+        bool play(int piece, int dir) override {
+            GameState next = stack.back();
+            Constants::MOVE_RESULT result = next.play(piece, dir);
+            if (result != Constants::MOVE_SUCCESS && result != Constants::MOVE_KILLED) {
+                return false;
+            }
+            stack.push_back(next);
+            return true;
+        }
+
+        void undo() override {
+            stack.pop_back();
+        }
+
+        uint64_t perft(int depth) override {
+            if (depth == 0) return 1;
+            return perft(stack.back(), depth);
+        }
+};
+
+
+// Runs perft from the root one move at a time so divide can list each move
+uint64_t runPerft(PerftEngine& engine, int depth, bool divide) {
+    uint64_t total = 0;
+    for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+        for (int dir = 0; dir < Constants::NUM_DIRECTIONS; dir++) {
+            if (!engine.play(piece, dir)) continue;
+
+            uint64_t nodes = engine.perft(depth - 1);
+            engine.undo();
+            total += nodes;
+
+            if (divide) {
+                std::cout << "  " << char('1' + piece) << " " << Constants::DIRECTIONS[dir] << ": " << nodes << std::endl;
+            }
+        }
+    }
+    return total;
+}
+
+
+int main(int argc, char* argv[]) {
+    int depth = 4;
+    int side = 0;
+    bool divide = false;
+    std::string engineName = "all";
+    std::string boardFile = Constants::BOARD_2_PLAYER;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-depth" && i + 1 < argc) {
+            depth = std::stoi(argv[++i]);
+        } else if (arg == "-board" && i + 1 < argc) {
+            boardFile = argv[++i];
+        } else if (arg == "-player" && i + 1 < argc) {
+            side = std::stoi(argv[++i]) - 1;
+        } else if (arg == "-engine" && i + 1 < argc) {
+            engineName = argv[++i];
+        } else if (arg == "-divide") {
+            divide = true;
+        } else if (arg == "-help") {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -depth N       Search depth in plies (default: 4)" << std::endl;
+            std::cout << "  -board FILE    Start position in board.txt format (default: board.txt)" << std::endl;
+            std::cout << "  -player N      Player to move first, 1 or 2 (default: 1)" << std::endl;
+            std::cout << "  -engine NAME   object, board, state or all (default: all)" << std::endl;
+            std::cout << "  -divide        Show the node count below each root move" << std::endl;
+            std::cout << "  -help          Show this help message" << std::endl;
+            return 0;
+        }
+    }
+
+    if (depth < 1 || side < 0 || side > 1) {
+        std::cerr << "Depth must be at least 1 and player must be 1 or 2" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> layout;
+    if (!Board::readLayout(boardFile, layout)) {
+        return 1;
+    }
+
+    std::vector<Player> players;
+    for (int i = 0; i < 2; i++) {
+        players.emplace_back(i, Constants::PLAYER_STARTING_PIECES[i]);
+    }
+
+    // No controller: no views to notify
+    Board board{Constants::BOARD_SIZE_2_PLAYER, Constants::BOARD_WIDTH_2_PLAYER, nullptr};
+    board.init(layout, players);
+
+    GameState root = board.saveState();
+    root.sideToMove = side;
+    root.hash = Zobrist::hash(root);
+    board.loadState(root);
+
+    std::vector<std::unique_ptr<PerftEngine>> engines;
+    if (engineName == "object" || engineName == "all") {
+        engines.push_back(std::make_unique<ObjectEngine>(board, players));
+    }
+    if (engineName == "board" || engineName == "all") {
+        engines.push_back(std::make_unique<BoardEngine>(board));
+    }
+    if (engineName == "state" || engineName == "all") {
+        engines.push_back(std::make_unique<StateEngine>(root));
+    }
+    if (engines.empty()) {
+        std::cerr << "Unknown engine: " << engineName << std::endl;
+        return 1;
+    }
+
+    std::cout << "perft depth " << depth << " from " << boardFile
+              << ", player " << side + 1 << " to move" << std::endl;
+
+    uint64_t expected = 0;
+    bool mismatch = false;
+
+    for (size_t i = 0; i < engines.size(); i++) {
+        if (divide) {
+            std::cout << engines[i]->getName() << " divide:" << std::endl;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = runPerft(*engines[i], depth, divide);
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double nps = seconds > 0 ? nodes / seconds : 0.0;
+
+        std::cout << engines[i]->getName() << ": " << nodes << " nodes in "
+                  << seconds << "s (" << static_cast<uint64_t>(nps) << " nodes/s)" << std::endl;
+
+        if (i == 0) {
+            expected = nodes;
+        } else if (nodes != expected) {
+            mismatch = true;
+        }
+    }
+
+    if (mismatch) {
+        std::cout << "[ERROR] Engines disagree on the node count" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "../ai/ainetwork.h"
+#include "../ai/aiplayer.h"
+#include "../ai/quantizednetwork.h"
+#include "../game/board.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// Longest self-play game before starting a new one
+const int MAX_PLIES = 200;
+// Share of self-play moves picked at random, so the positions aren't only
+// the network's own favourite lines
+const double RANDOM_MOVES = 0.2;
+
+// Keeps the compiler from dropping the timed calls
+volatile float sink;
+
+
+// Index of the legal move with the highest Q-value
+int bestMove(const std::vector<float>& qValues, const MoveList& moves) {
+    int best = 0;
+    float bestQValue = -std::numeric_limits<float>::infinity();
+    for (int i = 0; i < moves.size(); i++) {
+        float qValue = qValues[moves[i].getActionIndex()];
+        if (qValue > bestQValue) {
+            bestQValue = qValue;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Network inputs of count positions from epsilon-greedy self-play of
+// network, with the legal moves of each
+void selfPlay(AINetwork& network, const GameState& start, int count, std::mt19937& rng,
+              std::vector<float>& features, std::vector<MoveList>& legalMoves) {
+    const int inputs = network.getInputSize();
+    std::vector<float> qValues(network.getOutputSize());
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    features.resize(static_cast<size_t>(count) * inputs);
+    legalMoves.resize(count);
+    int positions = 0;
+    while (positions < count) {
+        GameState state = start;
+        for (int ply = 0; ply < MAX_PLIES && positions < count && !state.isGameOver(); ply++) {
+            MoveList& moves = legalMoves[positions];
+            state.generateMoves(moves);
+            if (moves.empty()) break;
+
+            float* position = features.data() + static_cast<size_t>(positions) * inputs;
+            AIPlayer::stateToVector(state, position);
+            positions++;
+
+            int choice;
+            if (dist(rng) < RANDOM_MOVES) {
+                choice = std::uniform_int_distribution<int>(0, moves.size() - 1)(rng);
+            } else {
+                network.predict(position, qValues.data());
+                choice = bestMove(qValues, moves);
+            }
+            state.play(moves[choice]);
+        }
+    }
+}
+
+// Microseconds per call of run, calling it for about seconds
+template <typename Run>
+double timeCall(Run run, double seconds) {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t calls = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    while (elapsed < seconds) {
+        for (int i = 0; i < 64; i++) {
+            run();
+        }
+        calls += 64;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return elapsed * 1e6 / calls;
+}
+
+
+int main(int argc, char* argv[]) {
+    int numPositions = 4000;
+    std::string modelFile = "ai_player_0_final.model";
+    std::string outFile;
+    std::string boardFile = Constants::BOARD_2_PLAYER;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-model" && i + 1 < argc) {
+            modelFile = argv[++i];
+        } else if (arg == "-out" && i + 1 < argc) {
+            outFile = argv[++i];
+        } else if (arg == "-positions" && i + 1 < argc) {
+            numPositions = std::stoi(argv[++i]);
+        } else if (arg == "-board" && i + 1 < argc) {
+            boardFile = argv[++i];
+        } else if (arg == "-help") {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cout << "Converts a trained model to int8 for play (animalchess -int8) and reports" << std::endl;
+            std::cout << "how often it picks the same move as the float network" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -model FILE    Model to quantize (default: ai_player_0_final.model)" << std::endl;
+            std::cout << "  -out FILE      Int8 network to write (default: model name + .q8)" << std::endl;
+            std::cout << "  -positions N   Self-play positions, half calibrate and half test (default: 4000)" << std::endl;
+            std::cout << "  -board FILE    Start position in board.txt format (default: board.txt)" << std::endl;
+            std::cout << "  -help          Show this help message" << std::endl;
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (numPositions < 2) {
+        std::cerr << "Error: -positions must be at least 2" << std::endl;
+        return 1;
+    }
+    if (outFile.empty()) {
+        outFile = modelFile + ".q8";
+    }
+
+    if (!std::ifstream{modelFile}) {
+        std::cerr << "Could not read or open file: " << modelFile << std::endl;
+        return 1;
+    }
+    AINetwork network(AIPlayer::getNetworkLayers());
+    network.loadFromFile(modelFile);
+
+    GameState start;
+    if (!Board::loadLayout(boardFile, start)) {
+        return 1;
+    }
+
+    // Even positions calibrate, odd ones are held out for the report
+    std::mt19937 rng(12345);
+    std::vector<float> features;
+    std::vector<MoveList> legalMoves;
+    selfPlay(network, start, numPositions, rng, features, legalMoves);
+
+    const int inputs = network.getInputSize();
+    std::vector<float> calibration;
+    std::vector<int> heldOut;
+    for (int p = 0; p < numPositions; p++) {
+        const float* position = features.data() + static_cast<size_t>(p) * inputs;
+        if (p % 2 == 0) {
+            calibration.insert(calibration.end(), position, position + inputs);
+        } else {
+            heldOut.push_back(p);
+        }
+    }
+
+    QuantizedNetwork quantized;
+    quantized.quantize(network, calibration, static_cast<int>(calibration.size() / inputs));
+
+    // Top legal move and Q-values against the float network
+    std::vector<float> expected(network.getOutputSize());
+    std::vector<float> output(network.getOutputSize());
+    int agreed = 0;
+    double totalError = 0.0;
+    float maxError = 0.0f;
+    int compared = 0;
+    for (int p : heldOut) {
+        const float* position = features.data() + static_cast<size_t>(p) * inputs;
+        network.predict(position, expected.data());
+        quantized.predict(position, output.data());
+
+        const MoveList& moves = legalMoves[p];
+        if (bestMove(expected, moves) == bestMove(output, moves)) agreed++;
+        for (const Move& move : moves) {
+            float error = std::fabs(output[move.getActionIndex()] - expected[move.getActionIndex()]);
+            totalError += error;
+            maxError = std::max(maxError, error);
+            compared++;
+        }
+    }
+
+    const float* position = features.data() + static_cast<size_t>(heldOut.front()) * inputs;
+    double floatUs = timeCall([&] { network.predict(position, expected.data()); sink = expected[0]; }, 0.3);
+    double int8Us = timeCall([&] { quantized.predict(position, output.data()); sink = output[0]; }, 0.3);
+
+    std::cout << "Calibrated on " << calibration.size() / inputs << " positions, tested on "
+              << heldOut.size() << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Top move agreement: " << 100.0 * agreed / heldOut.size() << "%" << std::endl;
+    std::cout << std::setprecision(4);
+    std::cout << "Legal move Q-value error: mean " << totalError / std::max(compared, 1)
+              << ", max " << maxError << std::endl;
+    std::cout << std::setprecision(2);
+    std::cout << "Forward pass: float " << floatUs << "us, int8 (" << QuantizedNetwork::getKernelName()
+              << ") " << int8Us << "us, " << floatUs / int8Us << "x" << std::endl;
+
+    if (!quantized.saveToFile(outFile)) {
+        return 1;
+    }
+    std::cout << "Wrote " << outFile << std::endl;
+    return 0;
+}
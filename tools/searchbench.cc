@@ -0,0 +1,135 @@
+#include "../ai/searchplayer.h"
+#include "../game/board.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Positions to search: the start position plus a few reached by random
+// play from it, the same ones every run
+std::vector<GameState> makePositions(const GameState& start, int count) {
+    std::vector<GameState> positions{start};
+    std::mt19937 rng(12345);
+
+    while (positions.size() < static_cast<size_t>(count)) {
+        GameState state = start;
+        int plies = 8 * positions.size();
+
+        for (int i = 0; i < plies; i++) {
+            MoveList moves;
+            state.generateMoves(moves);
+            if (moves.empty()) break;
+            state.play(moves[rng() % moves.size()]);
+        }
+
+        MoveList moves;
+        state.generateMoves(moves);
+        if (!moves.empty()) {
+            positions.push_back(state);
+        }
+    }
+    return positions;
+}
+
+
+std::vector<int> parseThreadCounts(const std::string& list) {
+    std::vector<int> counts;
+    std::stringstream stream{list};
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        counts.push_back(std::stoi(item));
+    }
+    return counts;
+}
+
+
+int main(int argc, char* argv[]) {
+    int depth = 9;
+    int numPositions = 4;
+    int hashMb = 64;
+    std::string threadList = "1,2,4,8,16";
+    std::string boardFile = Constants::BOARD_2_PLAYER;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-depth" && i + 1 < argc) {
+            depth = std::stoi(argv[++i]);
+        } else if (arg == "-positions" && i + 1 < argc) {
+            numPositions = std::stoi(argv[++i]);
+        } else if (arg == "-hash" && i + 1 < argc) {
+            hashMb = std::stoi(argv[++i]);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threadList = argv[++i];
+        } else if (arg == "-board" && i + 1 < argc) {
+            boardFile = argv[++i];
+        } else if (arg == "-help") {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -depth N       Search every position to this depth (default: 9)" << std::endl;
+            std::cout << "  -positions N   Number of test positions (default: 4)" << std::endl;
+            std::cout << "  -hash MB       Transposition table size (default: 64)" << std::endl;
+            std::cout << "  -threads LIST  Comma separated thread counts (default: 1,2,4,8,16)" << std::endl;
+            std::cout << "  -board FILE    Start position in board.txt format (default: board.txt)" << std::endl;
+            std::cout << "  -help          Show this help message" << std::endl;
+            return 0;
+        }
+    }
+
+    GameState start;
+    if (!Board::loadLayout(boardFile, start)) {
+        return 1;
+    }
+
+    std::vector<GameState> positions = makePositions(start, numPositions);
+
+    std::cout << "search benchmark: " << positions.size() << " positions to depth " << depth
+              << ", " << hashMb << "MB hash, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "nodes" << std::setw(12) << "time (s)"
+              << std::setw(14) << "nodes/s" << std::setw(10) << "speedup" << std::setw(10) << "qnodes"
+              << std::setw(10) << "1st cut" << std::endl;
+
+    double baseTime = 0.0;
+    for (int threads : parseThreadCounts(threadList)) {
+        // Effectively no time limit: every thread count searches to the same depth
+        SearchPlayer player(0, Constants::PLAYER_STARTING_PIECES[0], depth, 24 * 60 * 60 * 1000, hashMb, threads);
+        player.setVerbose(false);
+
+        uint64_t nodes = 0;
+        uint64_t quiescenceNodes = 0;
+        uint64_t betaCutoffs = 0;
+        uint64_t firstMoveCutoffs = 0;
+        double seconds = 0.0;
+        for (const GameState& position : positions) {
+            // Every position starts from an empty table
+            player.getTable().clear();
+            SearchResult result = player.search(position);
+            nodes += result.nodes;
+            quiescenceNodes += result.quiescenceNodes;
+            betaCutoffs += result.betaCutoffs;
+            firstMoveCutoffs += result.firstMoveCutoffs;
+            seconds += result.seconds;
+        }
+
+        if (baseTime == 0.0) {
+            baseTime = seconds;
+        }
+
+        std::cout << std::setw(8) << threads << std::setw(14) << nodes
+                  << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(14) << static_cast<uint64_t>(seconds > 0 ? nodes / seconds : 0)
+                  << std::setw(10) << std::setprecision(2) << (seconds > 0 ? baseTime / seconds : 0.0)
+                  << std::setw(9) << std::setprecision(1) << (nodes ? 100.0 * quiescenceNodes / nodes : 0.0) << "%"
+                  << std::setw(9) << (betaCutoffs ? 100.0 * firstMoveCutoffs / betaCutoffs : 0.0) << "%" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include "../ai/tablebase.h"
+#include "../game/bitboard.h"
+#include "../game/board.h"
+#include "../game/constants.h"
+#include "../game/gamestate.h"
+#include "../game/move.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+    constexpr uint8_t UNKNOWN = 0xff;
+
+    // Work::flags
+    constexpr uint8_t EXIT_WIN = 1;   // a capture or den entry wins
+    constexpr uint8_t EXIT_DRAW = 2;  // a capture leads to a drawn smaller table
+
+    constexpr int MOVER_MASK = (1 << Constants::NUM_PIECES) - 1;
+
+    // Same pieces with the other side to move
+    int swapSides(int key) {
+        return (key >> Constants::NUM_PIECES) | ((key & MOVER_MASK) << Constants::NUM_PIECES);
+    }
+}
+
+
+// Retrograde solver for one table, or for a pair of tables whose positions
+// lead into each other: moves of the side to move in one are positions
+// with the other side to move, which is the other table turned round.
+//
+// Captures and den entries leave the pair, their results come from smaller
+// tables that are already finished. Within the pair results spread backwards
+// one ply at a time from the lost positions: a position with a move to a
+// loss at d is won at d + 1, one whose every move reaches a win is lost one
+// ply after the slowest of them. Whatever is left at the end is a draw.
+class PairSolver {
+    struct Work {
+        int key;
+        std::vector<uint8_t> value;    // encoded result, UNKNOWN until solved
+        std::vector<uint8_t> counter;  // quiet moves not yet known to lose
+        std::vector<uint8_t> maxWin;   // slowest win for the opponent found so far
+        std::vector<uint8_t> flags;
+    };
+
+    const Tablebase& smaller;
+    const GameState& layout;
+    Work work[2];
+    int tableCount;
+
+    // Positions to settle at each distance: index, table << 32, win << 33
+    std::vector<std::vector<uint64_t>> levels;
+
+    static uint64_t entry(int table, uint32_t index, bool win) {
+        return uint64_t(index) | uint64_t(table) << 32 | uint64_t(win) << 33;
+    }
+
+    bool schedule(int table, uint32_t index, int dtm, bool win) {
+        if (dtm > Tablebase::MAX_DTM) return false;
+        levels[dtm].push_back(entry(table, index, win));
+        return true;
+    }
+
+    int otherTable(int table) const {
+        return tableCount == 1 ? table : table ^ 1;
+    }
+
+    bool initialise(int table) {
+        Work& w = work[table];
+        size_t size = Tablebase::tableSize(Tablebase::pieceCount(w.key));
+        w.value.assign(size, UNKNOWN);
+        w.counter.assign(size, 0);
+        w.maxWin.assign(size, 0);
+        w.flags.assign(size, 0);
+
+        GameState state = layout;
+        MoveList moves;
+
+        for (uint32_t index = 0; index < size; index++) {
+            if (!Tablebase::setup(w.key, index, state)) {
+                w.value[index] = Tablebase::encode(WDL::Draw, 0);
+                continue;
+            }
+
+            state.generateMoves(moves);
+            if (moves.empty()) {
+                schedule(table, index, 0, false);
+                continue;
+            }
+
+            int fastestWin = Tablebase::MAX_DTM + 1;
+            for (const Move& move : moves) {
+                uint64_t toBit = GameState::bit(move.to);
+
+                if (state.denMask[0] & toBit) {
+                    fastestWin = 1;
+                    continue;
+                }
+                if (!(state.occupied[1] & toBit)) {
+                    w.counter[index]++;
+                    continue;
+                }
+
+                // Captured or killed, one piece fewer
+                GameState next = state;
+                next.play(move);
+                TBResult result;
+                if (!smaller.probe(next, result)) {
+                    std::cerr << "Error: Smaller table missing" << std::endl;
+                    return false;
+                }
+
+                if (result.wdl == WDL::Loss) {
+                    fastestWin = std::min(fastestWin, result.dtm + 1);
+                }
+                else if (result.wdl == WDL::Win) {
+                    w.maxWin[index] = std::max<int>(w.maxWin[index], result.dtm);
+                }
+                else {
+                    w.flags[index] |= EXIT_DRAW;
+                }
+            }
+
+            if (fastestWin <= Tablebase::MAX_DTM) {
+                w.flags[index] |= EXIT_WIN;
+                schedule(table, index, fastestWin, true);
+            }
+            else if (w.counter[index] == 0 && !(w.flags[index] & EXIT_DRAW)) {
+                if (!schedule(table, index, w.maxWin[index] + 1, false)) return false;
+            }
+        }
+        return true;
+    }
+
+    // Calls visit(table, index) for every position in the pair whose quiet
+    // move leads to position index of table
+    template <typename Visit>
+    void predecessors(int table, uint32_t index, Visit visit) const {
+        GameState state = layout;
+        Tablebase::setup(work[table].key, index, state);
+        uint64_t all = state.occupied[0] | state.occupied[1];
+        int previous = otherTable(table);
+
+        // Undo a move of the side that just moved: player 1 here
+        for (int piece = 0; piece < Constants::NUM_PIECES; piece++) {
+            int to = state.pieceSquare[1][piece];
+            if (to < 0) continue;
+
+            bool leaps = (piece == 5 || piece == 6);
+            for (int dir = 0; dir < Constants::NUM_DIRECTIONS; dir++) {
+                // It came from the opposite direction: N/S and E/W are pairs
+                uint64_t from = Bitboard::STEPS.step[dir ^ 1][to];
+                if (leaps && (from & state.waterMask)) {
+                    while (from & state.waterMask & ~all) {
+                        from = Bitboard::STEPS.step[dir ^ 1][Bitboard::lsb(from)];
+                    }
+                }
+                if (!from || (from & (all | state.denMask[0] | state.denMask[1]))) continue;
+                if (piece != 0 && (from & state.waterMask)) continue;
+
+                GameState before = state;
+                before.occupied[1] = (before.occupied[1] & ~GameState::bit(to)) | from;
+                before.pieceSquare[1][piece] = Bitboard::lsb(from);
+                before.sideToMove = 1;
+
+                // The move must be one the rules allow, and land back on to
+                Move move;
+                if (before.resolve(piece, dir, move) != Constants::MOVE_SUCCESS || move.to != to) continue;
+
+                int key;
+                uint32_t beforeIndex;
+                Tablebase::locate(before, key, beforeIndex);
+                visit(previous, beforeIndex);
+            }
+        }
+    }
+
+public:
+    PairSolver(const Tablebase& smaller, const GameState& layout, int key)
+        : smaller(smaller), layout(layout), levels(Tablebase::MAX_DTM + 1)
+    {
+        work[0].key = key;
+        work[1].key = swapSides(key);
+        tableCount = work[0].key == work[1].key ? 1 : 2;
+    }
+
+    bool solve() {
+        for (int table = 0; table < tableCount; table++) {
+            if (!initialise(table)) return false;
+        }
+
+        bool ok = true;
+        for (int dtm = 0; dtm <= Tablebase::MAX_DTM && ok; dtm++) {
+            // Entries are only ever added to later levels
+            for (size_t i = 0; i < levels[dtm].size() && ok; i++) {
+                uint64_t item = levels[dtm][i];
+                uint32_t index = uint32_t(item);
+                int table = (item >> 32) & 1;
+                bool win = (item >> 33) & 1;
+
+                if (work[table].value[index] != UNKNOWN) continue;
+                work[table].value[index] = Tablebase::encode(win ? WDL::Win : WDL::Loss, dtm);
+
+                predecessors(table, index, [&](int before, uint32_t beforeIndex) {
+                    Work& w = work[before];
+                    if (w.value[beforeIndex] != UNKNOWN) return;
+
+                    if (!win) {
+                        ok = ok && schedule(before, beforeIndex, dtm + 1, true);
+                        return;
+                    }
+
+                    w.maxWin[beforeIndex] = std::max<int>(w.maxWin[beforeIndex], dtm);
+                    if (--w.counter[beforeIndex] == 0 && !(w.flags[beforeIndex] & (EXIT_WIN | EXIT_DRAW))) {
+                        ok = ok && schedule(before, beforeIndex, w.maxWin[beforeIndex] + 1, false);
+                    }
+                });
+            }
+            std::vector<uint64_t>().swap(levels[dtm]);
+        }
+
+        if (!ok) {
+            std::cerr << "Error: A result is more than " << Tablebase::MAX_DTM << " plies away" << std::endl;
+            return false;
+        }
+
+        // Nobody can force a result from what is left
+        for (int table = 0; table < tableCount; table++) {
+            for (uint8_t& value : work[table].value) {
+                if (value == UNKNOWN) value = Tablebase::encode(WDL::Draw, 0);
+            }
+        }
+        return true;
+    }
+
+    int getTableCount() const { return tableCount; }
+    int getKey(int table) const { return work[table].key; }
+    std::vector<uint8_t>& getValues(int table) { return work[table].value; }
+};
+
+
+// Every material combination with both sides on the board, by piece count
+std::vector<std::vector<int>> pairsByPieces(int maxPieces) {
+    std::vector<std::vector<int>> pairs(maxPieces + 1);
+    for (int key = 0; key < Tablebase::TABLE_COUNT; key++) {
+        int pieces = Tablebase::pieceCount(key);
+        if (pieces > maxPieces || !(key & MOVER_MASK) || !(key >> Constants::NUM_PIECES)) continue;
+
+        // One solver per pair
+        if (key <= swapSides(key)) {
+            pairs[pieces].push_back(key);
+        }
+    }
+    return pairs;
+}
+
+
+bool writeFile(const std::string& filename, const GameState& layout, int maxPieces,
+               const std::vector<std::vector<uint8_t>>& tables) {
+    std::vector<Tablebase::FileEntry> entries;
+    uint64_t offset = 0;
+    for (int key = 0; key < Tablebase::TABLE_COUNT; key++) {
+        if (tables[key].empty()) continue;
+        Tablebase::FileEntry entry{};
+        entry.key = key;
+        entry.pieces = Tablebase::pieceCount(key);
+        entry.offset = offset;
+        entries.push_back(entry);
+        offset += (tables[key].size() + 63) & ~uint64_t(63);
+    }
+
+    Tablebase::FileHeader header = Tablebase::makeHeader(layout, maxPieces, entries.size());
+
+    // Tables start on a cache line after the directory
+    uint64_t dataStart = (sizeof(header) + entries.size() * sizeof(Tablebase::FileEntry) + 63) & ~uint64_t(63);
+    for (Tablebase::FileEntry& entry : entries) {
+        entry.offset += dataStart;
+    }
+
+    std::ofstream file{filename, std::ios::binary};
+    if (!file) {
+        std::cerr << "Error: Could not write " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<char> padding(64, 0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Tablebase::FileEntry));
+    file.write(padding.data(), dataStart - sizeof(header) - entries.size() * sizeof(Tablebase::FileEntry));
+
+    for (const Tablebase::FileEntry& entry : entries) {
+        const std::vector<uint8_t>& table = tables[entry.key];
+        file.write(reinterpret_cast<const char*>(table.data()), table.size());
+        file.write(padding.data(), ((table.size() + 63) & ~size_t(63)) - table.size());
+    }
+    return bool(file);
+}
+
+
+int main(int argc, char* argv[]) {
+    int maxPieces = 3;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string outFile = "endgame.tb";
+    std::string boardFile = Constants::BOARD_2_PLAYER;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-pieces" && i + 1 < argc) {
+            maxPieces = std::stoi(argv[++i]);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "-out" && i + 1 < argc) {
+            outFile = argv[++i];
+        } else if (arg == "-board" && i + 1 < argc) {
+            boardFile = argv[++i];
+        } else if (arg == "-help") {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  -pieces N      Solve every endgame with up to N pieces, 2-" << Tablebase::MAX_PIECES << " (default: 3)" << std::endl;
+            std::cout << "  -threads N     Tables solved at once (default: hardware threads)" << std::endl;
+            std::cout << "  -out FILE      Tablebase file to write (default: endgame.tb)" << std::endl;
+            std::cout << "  -board FILE    Layout in board.txt format (default: board.txt)" << std::endl;
+            std::cout << "  -help          Show this help message" << std::endl;
+            return 0;
+        }
+    }
+
+    if (maxPieces < 2 || maxPieces > Tablebase::MAX_PIECES) {
+        std::cerr << "Error: -pieces must be between 2 and " << Tablebase::MAX_PIECES << std::endl;
+        return 1;
+    }
+
+    GameState layout;
+    if (!Board::loadLayout(boardFile, layout)) {
+        return 1;
+    }
+
+    if (!Tablebase::isSymmetric(layout)) {
+        std::cerr << "Error: The tables need a board that looks the same turned round" << std::endl;
+        return 1;
+    }
+
+    Tablebase finished;
+    finished.setLayout(layout, maxPieces);
+    std::vector<std::vector<uint8_t>> tables(Tablebase::TABLE_COUNT);
+    std::vector<std::vector<int>> pairs = pairsByPieces(maxPieces);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int pieces = 2; pieces <= maxPieces; pieces++) {
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::mutex tablesMutex;
+
+        // Tables with the same piece count only read smaller ones
+        auto worker = [&]() {
+            size_t i;
+            while (!failed && (i = next++) < pairs[pieces].size()) {
+                PairSolver solver{finished, layout, pairs[pieces][i]};
+                if (!solver.solve()) {
+                    failed = true;
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(tablesMutex);
+                for (int table = 0; table < solver.getTableCount(); table++) {
+                    tables[solver.getKey(table)].swap(solver.getValues(table));
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back(worker);
+        }
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+        if (failed) return 1;
+
+        // Count what this piece count added
+        uint64_t counts[3] = {0, 0, 0};
+        int longest = 0;
+        size_t tableCount = 0;
+        for (int key = 0; key < Tablebase::TABLE_COUNT; key++) {
+            if (tables[key].empty() || Tablebase::pieceCount(key) != pieces) continue;
+            finished.setTable(key, tables[key].data());
+            tableCount++;
+
+            GameState state = layout;
+            for (uint32_t index = 0; index < tables[key].size(); index++) {
+                if (!Tablebase::setup(key, index, state)) continue;
+                TBResult result = Tablebase::decode(tables[key][index]);
+                counts[static_cast<int>(result.wdl) + 1]++;
+                longest = std::max(longest, result.dtm);
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << pieces << " pieces: " << tableCount << " tables, " << counts[2] << " wins, "
+                  << counts[0] << " losses, " << counts[1] << " draws, longest " << longest
+                  << " plies (" << seconds << "s)" << std::endl;
+    }
+
+    if (!writeFile(outFile, layout, maxPieces, tables)) {
+        return 1;
+    }
+
+    Tablebase check;
+    if (!check.open(outFile)) {
+        return 1;
+    }
+    std::cout << "Wrote " << outFile << std::endl;
+    return 0;
+}